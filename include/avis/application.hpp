@@ -7,21 +7,102 @@
 #include <avis/vulkan/screenquad.hpp>
 #include <avis/vulkan/handles.hpp>
 #include <avis/audio/io.hpp>
+#include <avis/audio/fft.hpp>
+#include <avis/audio/sdft.hpp>
+#include <avis/audio/encoding.hpp>
+#include <avis/audio/channels.hpp>
+#include <avis/audio/filterbank.hpp>
+#include <avis/audio/cqt.hpp>
+#include <avis/audio/multires.hpp>
+#include <avis/audio/decimator.hpp>
+#include <avis/audio/features.hpp>
+#include <avis/utils/aligned_buffer.hpp>
+#include <avis/utils/contiguous_fifo.hpp>
+#include <avis/utils/scope_exit.hpp>
+#include <avis/utils/spsc_ring.hpp>
+#include <avis/utils/thread_pool.hpp>
 
 #include <boost/lockfree/spsc_queue.hpp>
-#include <boost/circular_buffer.hpp>
 
 #include <array>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
 
 
 namespace avis {
 
+// playback format, files are decoded using their own channel layout and downmixed to stereo for playback
 constexpr auto audio_out_fmt  = audio::ffmpeg::stream_format{2, AV_CH_LAYOUT_STEREO, AV_SAMPLE_FMT_FLT, 192000};
-constexpr auto chunk_size     = 4096;
-constexpr auto chunks         = 1024;
+constexpr auto default_chunk_size = 4096;
+constexpr auto chunks             = 1024;
 
-constexpr auto texture_extent = VkExtent3D{chunk_size, chunks, 1};
-constexpr auto texture_bytes  = texture_extent.width * texture_extent.height * texture_extent.depth * 4;
+// decoding runs on its own thread, filling the playback and analysis queues: once either is full, the decoder sleeps
+// until both have been drained to the given fraction of their capacity, the timeout only guards against a stall
+constexpr auto decoder_refill_fraction = 0.5;
+constexpr auto decoder_wait_timeout    = std::chrono::milliseconds{100};
+
+// each channel is analysed into its own layer of the texture array, optionally followed by mid and side layers
+// derived from the first two channels
+constexpr auto mid_side_layers = 2;
+
+// minimum number of new chunks per frame for which the transforms are distributed across the worker pool
+constexpr auto parallel_chunk_threshold = 4;
+
+// chunk sizes selectable at runtime via the number keys, the default size uses the compile-time fft_plan
+constexpr auto selectable_chunk_sizes = std::array<std::size_t, 3>{{ 1024, default_chunk_size, 16384 }};
+
+// window overlap factors, cycled at runtime: consecutive analysis windows start every chunk_size / overlap samples
+constexpr auto selectable_overlaps = std::array<std::size_t, 3>{{ 1, 2, 4 }};
+
+// sliding DFT mode: number of tracked low-frequency bins (starting at bin 1) and samples per texture row
+constexpr auto sliding_dft_bins = 64;
+constexpr auto sliding_dft_hop  = 64;
+
+// range of magnitudes (in dB) mapped to [0, 1] by the dB encodings, the encoding is cycled at runtime
+constexpr auto spectrum_db_range = audio::db_range{-40.0f, 20.0f};
+
+// frequency axis, cycled at runtime: the linear scale shows the FFT bins, the mel and log scales rebin the spectrum
+// into a fixed number of bands between the given frequencies (in Hz), only the bands are uploaded
+constexpr auto filterbank_bands = 384;
+constexpr auto filterbank_f_min = 20.0;
+constexpr auto filterbank_f_max = 20000.0;
+
+// constant-Q scale: bins per octave and frequency range (in Hz) of the transform, bins below sample_rate * Q / n
+// are limited by the chunk size, not available in sliding DFT mode
+constexpr auto cqt_bins_per_octave = 24;
+constexpr auto cqt_f_min = 27.5;
+constexpr auto cqt_f_max = 20000.0;
+
+// multi-resolution scale: number of levels, each halving the sample rate, and the FFT size of the levels relative
+// to the chunk size, i.e. the chunk size is the resolution of the middle level, not available in sliding DFT mode
+constexpr auto multires_levels = 5;
+constexpr auto multires_size_divisor = 4;
+
+// decimation factors, cycled at runtime: the samples are lowpass filtered and decimated before the analysis, the
+// transforms then cover the lower 1 / factor of the spectrum with factor times the frequency resolution
+constexpr auto selectable_decimations = std::array<std::size_t, 6>{{ 1, 2, 4, 8, 16, 32 }};
+
+// spectral features: records buffered in the feature queue, further records are dropped while the queue is full
+constexpr auto feature_queue_size = chunks * 16;
+
+// display of the texture layers, cycled at runtime: all layers stacked vertically, a single layer, or the maximum
+// over all channel layers
+enum class layer_view : std::int32_t {
+    stacked,
+    single,
+    maximum,
+};
+
+
+// spectral features of one texture row and layer, published via application::get_feature_queue()
+struct feature_record {
+    std::int64_t             row;       // analysis windows since the start of playback
+    std::uint32_t            layer;
+    audio::spectral_features features;
+};
 
 
 class application final : private application_base {
@@ -29,17 +110,77 @@ public:
     application(application_info const& appinfo)
             : application_base(appinfo)
             , paused_{true}
-            , texture_offset_{0} {}
+            , audio_in_fmt_{audio_out_fmt}
+            , mid_side_{false}
+            , texture_layers_{0}
+            , layer_view_{layer_view::stacked}
+            , selected_layer_{0}
+            , texture_offset_{0}
+            , texture_row_pitch_{0}
+            , chunk_size_{default_chunk_size}
+            , requested_chunk_size_{default_chunk_size}
+            , overlap_index_{0}
+            , decimation_{1}
+            , requested_decimation_{1}
+            , sliding_dft_mode_{false}
+            , features_enabled_{false}
+            , encoding_{audio::spectrum_encoding::linear_f32}
+            , requested_encoding_{audio::spectrum_encoding::linear_f32}
+            , magnitude_mode_{audio::magnitude_mode::magnitude}
+            , frequency_scale_{audio::frequency_scale::linear}
+            , requested_frequency_scale_{audio::frequency_scale::linear}
+            , audio_workers_{}
+            , audio_fft_(audio_workers_.size())
+            , audio_fft_dynamic_(audio_workers_.size())
+            , audio_feature_queue_{feature_queue_size}
+            , audio_feature_row_{0}
+            , audio_decoder_waiting_{false}
+            , audio_decoder_playback_low_{false}
+            , audio_decoder_stop_{false}
+            , audio_decoder_failed_{false} {}
 
     using application_base::create;
     using application_base::destroy;
 
     void play(std::string const& file);
 
+    // single consumer: records of all layers in row order, only filled while the features are enabled
+    auto get_feature_queue() noexcept -> boost::lockfree::spsc_queue<feature_record>&;
+
 private:
+    // matches tex_data_ubo in ringbuffer.frag (std140)
+    struct texture_uniforms {
+        std::int32_t offset;
+        std::int32_t mode;      // 0: linear magnitudes, 1: normalized dB levels, 2: linear power
+        float        db_min;
+        float        db_max;
+        std::int32_t view;      // see layer_view
+        std::int32_t layer;     // layer shown in single view
+        std::int32_t channels;  // number of channel layers, followed by the mid/side layers
+        float        xview_begin;   // displayed range of the texture width, as fraction of it
+        float        xview_end;
+    };
+
     void frame_update();
+
+    void decode_loop();
+    void wait_for_decoder_queues();
+    void stop_decoder();
     void frame_draw();
 
+    void update_texture_format();
+    void toggle_sliding_dft_mode() noexcept;
+    void toggle_mid_side();
+    auto get_texture_layers() const noexcept -> std::uint32_t;
+    void reset_decimation();
+    auto get_sample_rate() const noexcept -> double;
+    void setup_row_buffers();
+    void setup_feature_extractors();
+    auto get_window_size() const noexcept -> std::size_t;
+    auto get_row_size() const noexcept -> std::size_t;
+    void apply_magnitude_mode() noexcept;
+    auto get_texture_extent() const noexcept -> VkExtent3D;
+
     int cb_audio(void* outbuf, unsigned long framecount, PaStreamCallbackTimeInfo const* time, unsigned long flags);
 
     void cb_create() override;
@@ -67,7 +208,25 @@ private:
 
 private:
     std::atomic_bool paused_;
+    audio::ffmpeg::stream_format audio_in_fmt_;
+    bool             mid_side_;
+    std::uint32_t    texture_layers_;
+    layer_view       layer_view_;
+    std::uint32_t    selected_layer_;
     std::int32_t     texture_offset_;
+    VkDeviceSize     texture_row_pitch_;
+    std::size_t      chunk_size_;
+    std::size_t      requested_chunk_size_;
+    std::size_t      overlap_index_;
+    std::size_t      decimation_;
+    std::size_t      requested_decimation_;
+    bool             sliding_dft_mode_;
+    bool             features_enabled_;
+    audio::spectrum_encoding encoding_;
+    audio::spectrum_encoding requested_encoding_;
+    audio::magnitude_mode    magnitude_mode_;
+    audio::frequency_scale   frequency_scale_;
+    audio::frequency_scale   requested_frequency_scale_;
 
     vulkan::shader_module            vert_shader_module_;
     vulkan::shader_module            frag_shader_module_;
@@ -80,7 +239,7 @@ private:
     vulkan::pipeline                 pipeline_;
     std::vector<vulkan::framebuffer> framebuffers_;
     vulkan::screenquad               screenquad_;
-    vulkan::image                    texture_staging_image_;
+    vulkan::buffer                   texture_staging_buffer_;
     vulkan::image                    texture_image_;
     vulkan::image_view               texture_view_;
     vulkan::sampler                  texture_sampler_;
@@ -96,13 +255,40 @@ private:
 
     audio::ffmpeg::audio_input_stream audio_in_;
     audio::portaudio::output_stream   audio_out_;
-    std::int64_t                      audio_out_sample_size_;
-    std::vector<std::uint8_t>         audio_rdbuf_;
-    std::unique_ptr<boost::lockfree::spsc_queue<std::uint8_t>> audio_queue_;
-    boost::circular_buffer<float>     audio_imgbuf_;
+    std::vector<float>                audio_downmix_;  // left and right gain per channel
+    std::unique_ptr<utils::spsc_ring<float>> audio_queue_;             // playback frames (stereo)
+    std::unique_ptr<utils::spsc_ring<float>> audio_analysis_queue_;    // input frames
+    std::size_t                       audio_queue_refill_;     // frames
+    std::size_t                       audio_analysis_refill_;
+    std::vector<utils::contiguous_fifo<float>> audio_imgbuf_;  // one per layer
+    std::vector<utils::contiguous_fifo<float>> audio_decbuf_;  // decimated samples, one per layer
+    std::vector<audio::polyphase_decimator<float>> audio_decimator_;   // one per layer
+    utils::thread_pool                audio_workers_;
+    std::vector<audio::fft_plan<default_chunk_size>> audio_fft_;        // one plan per worker
+    std::vector<audio::dynamic_fft_plan<float>>      audio_fft_dynamic_;
+    std::vector<audio::multires_plan<float>>         audio_multires_;   // one plan per worker
+    std::vector<audio::sliding_dft<float>>     audio_sdft_;    // one per layer
+    std::vector<utils::aligned_buffer<float>> audio_rowbuf_;   // one row per layer and one for the bands per worker
+    std::vector<utils::aligned_buffer<std::complex<float>>> audio_specbuf_;    // complex spectrum per worker
+    audio::filterbank<float>          audio_filterbank_;
+    audio::constant_q_transform<float> audio_cqt_;
+    std::vector<audio::feature_extractor<float>> audio_features_;  // one per worker and layer
+    std::vector<feature_record>       audio_feature_rows_;  // records of the rows transformed in this frame
+    boost::lockfree::spsc_queue<feature_record> audio_feature_queue_;
+    std::int64_t                      audio_feature_row_;
     std::atomic_bool                  audio_eof_;
     std::atomic<std::int64_t>         audio_samples_written_;
     std::int64_t                      audio_samples_displayed_;
+
+    // decoder thread, owns audio_in_ while running and is the only producer of both queues
+    std::thread                       audio_decoder_;
+    std::mutex                        audio_decoder_mutex_;
+    std::condition_variable           audio_decoder_cv_;
+    std::atomic_bool                  audio_decoder_waiting_;
+    std::atomic_bool                  audio_decoder_playback_low_; // set by cb_audio(), consumed by frame_update()
+    std::atomic_bool                  audio_decoder_stop_;
+    std::atomic_bool                  audio_decoder_failed_;   // set once audio_decoder_error_ is valid
+    std::exception_ptr                audio_decoder_error_;    // rethrown by frame_update(), or by play()
 };
 
 } /* namespace avis */
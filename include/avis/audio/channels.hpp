@@ -0,0 +1,209 @@
+#pragma once
+
+#include <avis/audio/fft/kernels.hpp>
+
+#include <algorithm>
+#include <cstddef>
+
+
+namespace avis {
+namespace audio {
+
+// Split interleaved frames into one planar buffer per channel. If mid and side are given, the mid and side signals
+// of the first two channels, M = (c0 + c1) / 2 and S = (c0 - c1) / 2, are derived in the same pass.
+
+namespace detail {
+
+template <std::size_t C, class real_t>
+inline void deinterleave_fixed(real_t const* src, std::size_t frames, real_t* const* dst, real_t* mid,
+        real_t* side)
+{
+    // with a fixed channel count the strided loads are unrolled and can be vectorized
+    real_t* out[C];
+    std::copy(dst, dst + C, out);
+
+    constexpr std::size_t second = C > 1 ? 1 : 0;
+    auto const half = static_cast<real_t>(0.5);
+
+    if (mid != nullptr && side != nullptr) {
+        for (std::size_t i = 0; i < frames; i++) {
+            for (std::size_t c = 0; c < C; c++)
+                out[c][i] = src[i * C + c];
+
+            mid[i]  = (src[i * C] + src[i * C + second]) * half;
+            side[i] = (src[i * C] - src[i * C + second]) * half;
+        }
+    } else {
+        for (std::size_t i = 0; i < frames; i++) {
+            for (std::size_t c = 0; c < C; c++)
+                out[c][i] = src[i * C + c];
+        }
+    }
+}
+
+template <class real_t>
+inline void deinterleave_generic(real_t const* src, std::size_t frames, std::size_t channels, real_t* const* dst,
+        real_t* mid, real_t* side)
+{
+    for (std::size_t c = 0; c < channels; c++) {
+        for (std::size_t i = 0; i < frames; i++)
+            dst[c][i] = src[i * channels + c];
+    }
+
+    if (mid != nullptr && side != nullptr && channels > 1) {
+        auto const half = static_cast<real_t>(0.5);
+
+        for (std::size_t i = 0; i < frames; i++) {
+            mid[i]  = (dst[0][i] + dst[1][i]) * half;
+            side[i] = (dst[0][i] - dst[1][i]) * half;
+        }
+    }
+}
+
+} /* namespace detail */
+
+
+namespace deinterleave_kernels {
+
+// Stereo deinterleaving (optionally with mid/side), the most common layout, with explicit shuffles: the compiler
+// does not vectorize the stride-2 loads of deinterleave_fixed<2> well.
+template <class real_t>
+using stereo_fn = void (*)(real_t const* src, std::size_t frames, real_t* left, real_t* right, real_t* mid,
+        real_t* side);
+
+template <class real_t>
+inline void stereo_scalar(real_t const* src, std::size_t frames, real_t* left, real_t* right, real_t* mid,
+        real_t* side)
+{
+    real_t* const dst[2] = { left, right };
+    detail::deinterleave_fixed<2>(src, frames, dst, mid, side);
+}
+
+
+#ifdef AVIS_AUDIO_FFT_X86_KERNELS
+
+__attribute__((target("avx2,fma")))
+inline void stereo_avx2(float const* src, std::size_t frames, float* left, float* right, float* mid, float* side)
+{
+    auto const half = _mm256_set1_ps(0.5f);
+    auto const ms   = mid != nullptr && side != nullptr;
+
+    std::size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        auto const a = _mm256_loadu_ps(src + 2 * i);
+        auto const b = _mm256_loadu_ps(src + 2 * i + 8);
+
+        // in-lane shuffles yield the pairs (0 1 4 5 | 2 3 6 7), restored by a cross-lane permute
+        auto const l = _mm256_castpd_ps(_mm256_permute4x64_pd(
+                _mm256_castps_pd(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0))), _MM_SHUFFLE(3, 1, 2, 0)));
+        auto const r = _mm256_castpd_ps(_mm256_permute4x64_pd(
+                _mm256_castps_pd(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1))), _MM_SHUFFLE(3, 1, 2, 0)));
+
+        _mm256_storeu_ps(left + i,  l);
+        _mm256_storeu_ps(right + i, r);
+
+        if (ms) {
+            _mm256_storeu_ps(mid + i,  _mm256_mul_ps(_mm256_add_ps(l, r), half));
+            _mm256_storeu_ps(side + i, _mm256_mul_ps(_mm256_sub_ps(l, r), half));
+        }
+    }
+
+    stereo_scalar(src + 2 * i, frames - i, left + i, right + i, ms ? mid + i : nullptr, ms ? side + i : nullptr);
+}
+
+__attribute__((target("avx512f")))
+inline void stereo_avx512(float const* src, std::size_t frames, float* left, float* right, float* mid,
+        float* side)
+{
+    auto const half = _mm512_set1_ps(0.5f);
+    auto const ms   = mid != nullptr && side != nullptr;
+    auto const even = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+    auto const odd  = _mm512_setr_epi32(1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31);
+
+    std::size_t i = 0;
+    for (; i + 16 <= frames; i += 16) {
+        auto const a = _mm512_loadu_ps(src + 2 * i);
+        auto const b = _mm512_loadu_ps(src + 2 * i + 16);
+
+        auto const l = _mm512_permutex2var_ps(a, even, b);
+        auto const r = _mm512_permutex2var_ps(a, odd,  b);
+
+        _mm512_storeu_ps(left + i,  l);
+        _mm512_storeu_ps(right + i, r);
+
+        if (ms) {
+            _mm512_storeu_ps(mid + i,  _mm512_mul_ps(_mm512_add_ps(l, r), half));
+            _mm512_storeu_ps(side + i, _mm512_mul_ps(_mm512_sub_ps(l, r), half));
+        }
+    }
+
+    stereo_scalar(src + 2 * i, frames - i, left + i, right + i, ms ? mid + i : nullptr, ms ? side + i : nullptr);
+}
+
+#endif /* AVIS_AUDIO_FFT_X86_KERNELS */
+
+template <class real_t>
+inline auto select_stereo() noexcept -> stereo_fn<real_t> {
+    return stereo_scalar<real_t>;
+}
+
+template <>
+inline auto select_stereo<float>() noexcept -> stereo_fn<float> {
+    switch (fft::get_kernel_isa()) {
+#ifdef AVIS_AUDIO_FFT_X86_KERNELS
+    case fft::kernel_isa::avx512:   return stereo_avx512;
+    case fft::kernel_isa::avx2:     return stereo_avx2;
+#endif
+    default:                        return stereo_scalar<float>;
+    }
+}
+
+} /* namespace deinterleave_kernels */
+
+
+template <class real_t>
+inline void deinterleave(real_t const* src, std::size_t frames, std::size_t channels, real_t* const* dst,
+        real_t* mid = nullptr, real_t* side = nullptr)
+{
+    // mid/side requires two channels
+    if (channels < 2) {
+        mid  = nullptr;
+        side = nullptr;
+    }
+
+    // common layouts: mono, stereo, quad, 5.1, 7.1
+    switch (channels) {
+    case 1:     detail::deinterleave_fixed<1>(src, frames, dst, mid, side);                 break;
+    case 2: {
+        static auto const fn = deinterleave_kernels::select_stereo<real_t>();
+        fn(src, frames, dst[0], dst[1], mid, side);
+        break;
+    }
+    case 4:     detail::deinterleave_fixed<4>(src, frames, dst, mid, side);                 break;
+    case 6:     detail::deinterleave_fixed<6>(src, frames, dst, mid, side);                 break;
+    case 8:     detail::deinterleave_fixed<8>(src, frames, dst, mid, side);                 break;
+    default:    detail::deinterleave_generic(src, frames, channels, dst, mid, side);        break;
+    }
+}
+
+// Mix interleaved frames down to interleaved stereo, gains holds the left and right gain of each channel.
+template <class real_t>
+inline void downmix_stereo(real_t const* src, std::size_t frames, std::size_t channels, real_t const* gains,
+        real_t* dst)
+{
+    for (std::size_t i = 0; i < frames; i++) {
+        auto left  = real_t{0};
+        auto right = real_t{0};
+
+        for (std::size_t c = 0; c < channels; c++) {
+            left  += src[i * channels + c] * gains[2 * c];
+            right += src[i * channels + c] * gains[2 * c + 1];
+        }
+
+        dst[2 * i]     = left;
+        dst[2 * i + 1] = right;
+    }
+}
+
+} /* namespace audio */
+} /* namespace avis */
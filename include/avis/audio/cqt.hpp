@@ -0,0 +1,357 @@
+#pragma once
+
+#include <avis/audio/fft.hpp>
+#include <avis/audio/fft/complex_plan.hpp>
+#include <avis/audio/fft/kernels.hpp>
+#include <avis/utils/constexpr_math.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+
+namespace avis {
+namespace audio {
+
+namespace cqt_kernels {
+
+// Dot product of n consecutive complex bins with the (conjugated) kernel weights of one row.
+template <class real_t>
+using dot_fn = std::complex<real_t> (*)(std::complex<real_t> const* src, std::complex<real_t> const* weights,
+        std::size_t n);
+
+template <class real_t>
+inline auto dot_scalar(std::complex<real_t> const* src, std::complex<real_t> const* weights, std::size_t n)
+        -> std::complex<real_t>
+{
+    auto re = real_t{0};
+    auto im = real_t{0};
+
+    for (std::size_t i = 0; i < n; i++) {
+        re += src[i].real() * weights[i].real() - src[i].imag() * weights[i].imag();
+        im += src[i].real() * weights[i].imag() + src[i].imag() * weights[i].real();
+    }
+
+    return {re, im};
+}
+
+
+#ifdef AVIS_AUDIO_FFT_X86_KERNELS
+
+// The complex values are processed interleaved: one accumulator collects (xr wr, xi wi), the other, using the
+// input with real and imaginary part swapped, (xi wr, xr wi). The real part is the alternating sum of the first,
+// the imaginary part the sum of the second accumulator.
+
+__attribute__((target("avx2,fma")))
+inline auto dot_avx2(std::complex<float> const* src, std::complex<float> const* weights, std::size_t n)
+        -> std::complex<float>
+{
+    auto const x = reinterpret_cast<float const*>(src);
+    auto const w = reinterpret_cast<float const*>(weights);
+
+    auto acc_re = _mm256_setzero_ps();
+    auto acc_im = _mm256_setzero_ps();
+
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto const xv = _mm256_loadu_ps(x + 2 * i);
+        auto const wv = _mm256_loadu_ps(w + 2 * i);
+
+        acc_re = _mm256_fmadd_ps(xv, wv, acc_re);
+        acc_im = _mm256_fmadd_ps(_mm256_permute_ps(xv, 0xb1), wv, acc_im);
+    }
+
+    // negate the odd lanes (xi wi) and sum both accumulators horizontally
+    acc_re = _mm256_xor_ps(acc_re, _mm256_setr_ps(0.0f, -0.0f, 0.0f, -0.0f, 0.0f, -0.0f, 0.0f, -0.0f));
+
+    auto sum = _mm_hadd_ps(
+            _mm_add_ps(_mm256_castps256_ps128(acc_re), _mm256_extractf128_ps(acc_re, 1)),
+            _mm_add_ps(_mm256_castps256_ps128(acc_im), _mm256_extractf128_ps(acc_im, 1)));
+    sum = _mm_hadd_ps(sum, sum);
+
+    auto result = std::complex<float>{_mm_cvtss_f32(sum), _mm_cvtss_f32(_mm_shuffle_ps(sum, sum, 1))};
+    for (; i < n; i++)
+        result += src[i] * weights[i];
+
+    return result;
+}
+
+__attribute__((target("avx512f")))
+inline auto fold_avx512(__m512 v) -> __m128 {
+    v = _mm512_add_ps(v, _mm512_maskz_shuffle_f32x4(0xffff, v, v, 0x4e));
+    v = _mm512_add_ps(v, _mm512_maskz_shuffle_f32x4(0xffff, v, v, 0xb1));
+    return _mm512_maskz_extractf32x4_ps(0xf, v, 0);
+}
+
+__attribute__((target("avx512f")))
+inline auto dot_avx512(std::complex<float> const* src, std::complex<float> const* weights, std::size_t n)
+        -> std::complex<float>
+{
+    auto const x = reinterpret_cast<float const*>(src);
+    auto const w = reinterpret_cast<float const*>(weights);
+
+    auto acc_re = _mm512_setzero_ps();
+    auto acc_im = _mm512_setzero_ps();
+
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto const xv = _mm512_loadu_ps(x + 2 * i);
+        auto const wv = _mm512_loadu_ps(w + 2 * i);
+
+        acc_re = _mm512_fmadd_ps(xv, wv, acc_re);
+        acc_im = _mm512_fmadd_ps(_mm512_maskz_permute_ps(0xffff, xv, 0xb1), wv, acc_im);
+    }
+
+    // remainder using masked loads
+    if (i < n) {
+        auto const mask = static_cast<__mmask16>((1u << (2 * (n - i))) - 1);
+        auto const xv = _mm512_maskz_loadu_ps(mask, x + 2 * i);
+        auto const wv = _mm512_maskz_loadu_ps(mask, w + 2 * i);
+
+        acc_re = _mm512_fmadd_ps(xv, wv, acc_re);
+        acc_im = _mm512_fmadd_ps(_mm512_maskz_permute_ps(0xffff, xv, 0xb1), wv, acc_im);
+    }
+
+    // negate the odd lanes (xi wi), fold both accumulators to 128 bit and sum them horizontally
+    acc_re = _mm512_mask_sub_ps(acc_re, 0xaaaa, _mm512_setzero_ps(), acc_re);
+
+    auto sum = _mm_hadd_ps(fold_avx512(acc_re), fold_avx512(acc_im));
+    sum = _mm_hadd_ps(sum, sum);
+
+    return {_mm_cvtss_f32(sum), _mm_cvtss_f32(_mm_shuffle_ps(sum, sum, 1))};
+}
+
+#endif /* AVIS_AUDIO_FFT_X86_KERNELS */
+
+template <class real_t>
+inline auto select_dot() noexcept -> dot_fn<real_t> {
+    return dot_scalar<real_t>;
+}
+
+template <>
+inline auto select_dot<float>() noexcept -> dot_fn<float> {
+    switch (fft::get_kernel_isa()) {
+#ifdef AVIS_AUDIO_FFT_X86_KERNELS
+    case fft::kernel_isa::avx512:   return dot_avx512;
+    case fft::kernel_isa::avx2:     return dot_avx2;
+#endif
+    default:                        return dot_scalar<float>;
+    }
+}
+
+} /* namespace cqt_kernels */
+
+
+// Constant-Q transform computed from the n/2 + 1 complex bins of an n-point real FFT (see fft_plan::
+// execute_spectrum) by multiplication with a precomputed sparse spectral kernel (Brown and Puckette). The bins are
+// geometrically spaced with the given number of bins per octave, starting at f_min, and have the constant quality
+// factor Q = 1 / (2^(1/b) - 1). Bin k correlates the input with a Hann-windowed complex exponential of length
+// Q fs / f_k centered in the frame, the spectral kernel is the DFT of this atom. The frame window of the FFT
+// applies on top of the atom, and atoms longer than the frame are truncated to it, i.e. bins below Q fs / n lose
+// resolution. Kernel values below threshold times the maximum of their row are dropped, the remaining non-zeros
+// of each row are consecutive and stored in the same sparse format as the filterbank weights. Atoms are scaled
+// such that a sinusoid at a bin frequency results in the same magnitude as its peak in the FFT output.
+template <class real_t = float>
+class constant_q_transform {
+public:
+    using complex_type = std::complex<real_t>;
+
+    static constexpr double default_threshold = 0.0054;
+
+    constant_q_transform()
+            : input_size_{0}
+            , bins_per_octave_{0}
+            , f_min_{0}
+            , offsets_{0}
+            , columns_{}
+            , weights_{}
+            , mode_{magnitude_mode::magnitude} {}
+
+    inline constant_q_transform(std::size_t n, double sample_rate, std::size_t bins_per_octave, double f_min,
+            double f_max, double threshold = default_threshold);
+
+    inline auto input_size()      const noexcept -> std::size_t;
+    inline auto output_size()     const noexcept -> std::size_t;
+    inline auto bins_per_octave() const noexcept -> std::size_t;
+
+    // center frequency of the given bin, in Hz
+    inline auto frequency(std::size_t bin) const noexcept -> double;
+
+    // number of stored kernel values
+    inline auto nonzeros() const noexcept -> std::size_t;
+
+    inline auto get_magnitude_mode() const noexcept -> magnitude_mode;
+    inline void set_magnitude_mode(magnitude_mode mode) noexcept;
+
+    inline void apply(complex_type const* src, complex_type* dst) const;
+    inline void apply(complex_type const* src, real_t* dst) const;
+
+private:
+    std::size_t                input_size_;
+    std::size_t                bins_per_octave_;
+    double                     f_min_;
+    std::vector<std::uint32_t> offsets_;
+    std::vector<std::uint32_t> columns_;
+    std::vector<complex_type>  weights_;
+    magnitude_mode             mode_;
+};
+
+
+template <class real_t>
+constexpr double constant_q_transform<real_t>::default_threshold;
+
+template <class real_t>
+constant_q_transform<real_t>::constant_q_transform(std::size_t n, double sample_rate, std::size_t bins_per_octave,
+        double f_min, double f_max, double threshold)
+        : input_size_{rfft_output_size(n)}
+        , bins_per_octave_{bins_per_octave}
+        , f_min_{f_min}
+        , offsets_{0}
+        , columns_{}
+        , weights_{}
+        , mode_{magnitude_mode::magnitude}
+{
+    if (n < 4)
+        throw std::invalid_argument("The constant-Q transform requires N to be at least four!");
+
+    if (bins_per_octave == 0)
+        throw std::invalid_argument("The constant-Q transform requires at least one bin per octave!");
+
+    f_max = std::min(f_max, sample_rate / 2.0);
+    if (!(f_min > 0.0 && f_min < f_max))
+        throw std::invalid_argument("Invalid constant-Q frequency range!");
+
+    auto const bins = static_cast<std::size_t>(std::floor(bins_per_octave * std::log2(f_max / f_min))) + 1;
+    auto const q    = 1.0 / (std::pow(2.0, 1.0 / bins_per_octave) - 1.0);
+
+    // frame window of the FFT, see dynamic_fft_plan
+    auto window = std::vector<double>(n);
+    for (std::size_t i = 0; i < n; i++)
+        window[i] = 0.5 * (1.0 - std::cos((2.0 * math::pi<double> * i) / (n - 1.0)));
+
+    auto window_sum = 0.0;
+    for (auto const w : window)
+        window_sum += w;
+
+    // the kernel is the unitary DFT of each atom, thus the correlation with the atom equals the sum over the
+    // product of the unitary spectra (Parseval)
+    auto plan   = fft::complex_plan<double>{n};
+    auto atom   = std::vector<std::complex<double>>(n);
+    auto kernel = std::vector<std::complex<double>>(n);
+
+    auto const scale = 1.0 / std::sqrt(static_cast<double>(n));
+
+    offsets_.reserve(bins + 1);
+    columns_.reserve(bins);
+
+    for (std::size_t k = 0; k < bins; k++) {
+        auto const f      = frequency(k);
+        auto const length = std::max<std::size_t>(std::min(static_cast<std::size_t>(std::ceil(q * sample_rate / f)),
+                n), 2);
+        auto const start  = (n - length) / 2;
+
+        // Hann-windowed atom, normalized against the frame window
+        auto atom_window = std::vector<double>(length);
+        auto norm = 0.0;
+        for (std::size_t i = 0; i < length; i++) {
+            atom_window[i] = 0.5 * (1.0 - std::cos((2.0 * math::pi<double> * (i + 1)) / (length + 1.0)));
+            norm += atom_window[i] * window[start + i];
+        }
+
+        auto const gain = window_sum / (std::sqrt(static_cast<double>(n)) * norm);
+
+        std::fill(atom.begin(), atom.end(), std::complex<double>{});
+        for (std::size_t i = 0; i < length; i++) {
+            auto const t = start + i;
+            atom[t] = std::polar(atom_window[i] * gain, 2.0 * math::pi<double> * f * t / sample_rate);
+        }
+
+        plan.execute(atom.data(), kernel.data());
+
+        // keep the consecutive range of the positive half-spectrum above the threshold, store conjugated
+        auto max = 0.0;
+        for (std::size_t j = 0; j < input_size_; j++)
+            max = std::max(max, std::abs(kernel[j]));
+
+        auto first = std::size_t{0};
+        auto last  = input_size_ - 1;
+        while (first < last && std::abs(kernel[first]) < threshold * max)
+            first++;
+        while (last > first && std::abs(kernel[last]) < threshold * max)
+            last--;
+
+        for (std::size_t j = first; j <= last; j++)
+            weights_.push_back(static_cast<complex_type>(std::conj(kernel[j]) * scale));
+
+        columns_.push_back(static_cast<std::uint32_t>(first));
+        offsets_.push_back(static_cast<std::uint32_t>(weights_.size()));
+    }
+}
+
+template <class real_t>
+auto constant_q_transform<real_t>::input_size() const noexcept -> std::size_t {
+    return input_size_;
+}
+
+template <class real_t>
+auto constant_q_transform<real_t>::output_size() const noexcept -> std::size_t {
+    return columns_.size();
+}
+
+template <class real_t>
+auto constant_q_transform<real_t>::bins_per_octave() const noexcept -> std::size_t {
+    return bins_per_octave_;
+}
+
+template <class real_t>
+auto constant_q_transform<real_t>::frequency(std::size_t bin) const noexcept -> double {
+    return f_min_ * std::pow(2.0, static_cast<double>(bin) / bins_per_octave_);
+}
+
+template <class real_t>
+auto constant_q_transform<real_t>::nonzeros() const noexcept -> std::size_t {
+    return weights_.size();
+}
+
+template <class real_t>
+auto constant_q_transform<real_t>::get_magnitude_mode() const noexcept -> magnitude_mode {
+    return mode_;
+}
+
+template <class real_t>
+void constant_q_transform<real_t>::set_magnitude_mode(magnitude_mode mode) noexcept {
+    mode_ = mode;
+}
+
+template <class real_t>
+void constant_q_transform<real_t>::apply(complex_type const* src, complex_type* dst) const {
+    static auto const fn = cqt_kernels::select_dot<real_t>();
+
+    for (std::size_t k = 0; k < columns_.size(); k++)
+        dst[k] = fn(src + columns_[k], weights_.data() + offsets_[k], offsets_[k + 1] - offsets_[k]);
+}
+
+// magnitudes according to the magnitude mode, in the same format as the rows written by fft_plan
+template <class real_t>
+void constant_q_transform<real_t>::apply(complex_type const* src, real_t* dst) const {
+    static auto const fn = cqt_kernels::select_dot<real_t>();
+
+    auto const power       = fft::norm_power<real_t>{1};
+    auto const approximate = fft::norm_approximate<real_t>{1};
+
+    for (std::size_t k = 0; k < columns_.size(); k++) {
+        auto const x = fn(src + columns_[k], weights_.data() + offsets_[k], offsets_[k + 1] - offsets_[k]);
+
+        switch (mode_) {
+        case magnitude_mode::power:         dst[k] = power(x);                  break;
+        case magnitude_mode::approximate:   dst[k] = approximate(x);            break;
+        case magnitude_mode::magnitude:     dst[k] = std::sqrt(power(x));       break;
+        }
+    }
+}
+
+} /* namespace audio */
+} /* namespace avis */
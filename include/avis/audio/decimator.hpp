@@ -0,0 +1,261 @@
+#pragma once
+
+#include <avis/audio/fft/kernels.hpp>
+#include <avis/utils/constexpr_math.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+
+namespace avis {
+namespace audio {
+
+namespace polyphase_kernels {
+
+// Polyphase FIR decimation: dst[j] = sum_p sum_i coefficients[p * taps + i] phases[p * stride + j + i], i.e. phase p
+// holds every factor-th input sample starting at p and is filtered by the coefficients p, p + factor, p + 2 factor,
+// ... of the prototype filter. All phases are contiguous along the outputs.
+template <class real_t>
+using decimate_fn = void (*)(real_t const* phases, std::size_t stride, real_t* dst, std::size_t count,
+        real_t const* coefficients, std::size_t factor, std::size_t taps);
+
+template <class real_t>
+inline void decimate_scalar(real_t const* phases, std::size_t stride, real_t* dst, std::size_t count,
+        real_t const* coefficients, std::size_t factor, std::size_t taps)
+{
+    for (std::size_t j = 0; j < count; j++) {
+        auto acc = real_t{0};
+
+        for (std::size_t p = 0; p < factor; p++) {
+            auto const x = phases + p * stride + j;
+            auto const h = coefficients + p * taps;
+
+            for (std::size_t i = 0; i < taps; i++)
+                acc += h[i] * x[i];
+        }
+
+        dst[j] = acc;
+    }
+}
+
+
+#ifdef AVIS_AUDIO_FFT_X86_KERNELS
+
+__attribute__((target("avx2,fma")))
+inline void decimate_avx2(float const* phases, std::size_t stride, float* dst, std::size_t count,
+        float const* coefficients, std::size_t factor, std::size_t taps)
+{
+    // two vectors of outputs per iteration, the coefficient loops are shared
+    std::size_t j = 0;
+    for (; j + 16 <= count; j += 16) {
+        auto acc0 = _mm256_setzero_ps();
+        auto acc1 = _mm256_setzero_ps();
+
+        for (std::size_t p = 0; p < factor; p++) {
+            auto const x = phases + p * stride + j;
+            auto const h = coefficients + p * taps;
+
+            for (std::size_t i = 0; i < taps; i++) {
+                auto const c = _mm256_set1_ps(h[i]);
+
+                acc0 = _mm256_fmadd_ps(c, _mm256_loadu_ps(x + i),     acc0);
+                acc1 = _mm256_fmadd_ps(c, _mm256_loadu_ps(x + i + 8), acc1);
+            }
+        }
+
+        _mm256_storeu_ps(dst + j,     acc0);
+        _mm256_storeu_ps(dst + j + 8, acc1);
+    }
+
+    decimate_scalar(phases + j, stride, dst + j, count - j, coefficients, factor, taps);
+}
+
+__attribute__((target("avx512f")))
+inline void decimate_avx512(float const* phases, std::size_t stride, float* dst, std::size_t count,
+        float const* coefficients, std::size_t factor, std::size_t taps)
+{
+    std::size_t j = 0;
+    for (; j + 32 <= count; j += 32) {
+        auto acc0 = _mm512_setzero_ps();
+        auto acc1 = _mm512_setzero_ps();
+
+        for (std::size_t p = 0; p < factor; p++) {
+            auto const x = phases + p * stride + j;
+            auto const h = coefficients + p * taps;
+
+            for (std::size_t i = 0; i < taps; i++) {
+                auto const c = _mm512_set1_ps(h[i]);
+
+                acc0 = _mm512_fmadd_ps(c, _mm512_loadu_ps(x + i),      acc0);
+                acc1 = _mm512_fmadd_ps(c, _mm512_loadu_ps(x + i + 16), acc1);
+            }
+        }
+
+        _mm512_storeu_ps(dst + j,      acc0);
+        _mm512_storeu_ps(dst + j + 16, acc1);
+    }
+
+    // remainder using masked loads and stores
+    for (; j < count; j += 16) {
+        auto const mask = static_cast<__mmask16>(count - j >= 16 ? 0xffff : (1u << (count - j)) - 1);
+
+        auto acc = _mm512_setzero_ps();
+        for (std::size_t p = 0; p < factor; p++) {
+            auto const x = phases + p * stride + j;
+            auto const h = coefficients + p * taps;
+
+            for (std::size_t i = 0; i < taps; i++)
+                acc = _mm512_fmadd_ps(_mm512_set1_ps(h[i]), _mm512_maskz_loadu_ps(mask, x + i), acc);
+        }
+
+        _mm512_mask_storeu_ps(dst + j, mask, acc);
+    }
+}
+
+#endif /* AVIS_AUDIO_FFT_X86_KERNELS */
+
+template <class real_t>
+inline auto select_decimate() noexcept -> decimate_fn<real_t> {
+    return decimate_scalar<real_t>;
+}
+
+template <>
+inline auto select_decimate<float>() noexcept -> decimate_fn<float> {
+    switch (fft::get_kernel_isa()) {
+#ifdef AVIS_AUDIO_FFT_X86_KERNELS
+    case fft::kernel_isa::avx512:   return decimate_avx512;
+    case fft::kernel_isa::avx2:     return decimate_avx2;
+#endif
+    default:                        return decimate_scalar<float>;
+    }
+}
+
+} /* namespace polyphase_kernels */
+
+
+// Streaming decimation by an integer factor: lowpass filtering with a windowed sinc (Blackman) of taps_per_phase
+// taps per output phase and cutoff at the output Nyquist frequency, evaluated in polyphase form so that only every
+// factor-th output is computed. Passband up to about 0.75, stopband from about 1.25 of the output Nyquist frequency,
+// i.e. the lower three quarters of the output band are free of aliasing. Each input sample is processed once, the
+// filter keeps the inputs not yet consumed between calls.
+template <class real_t = float>
+class polyphase_decimator {
+public:
+    static constexpr std::size_t taps_per_phase = 24;
+
+    polyphase_decimator()
+            : factor_{0}
+            , coefficients_{}
+            , history_{}
+            , phases_{}
+            , output_{} {}
+
+    inline explicit polyphase_decimator(std::size_t factor);
+
+    inline auto factor() const noexcept -> std::size_t;
+
+    // length of the prototype filter, i.e. inputs contributing to each output
+    inline auto filter_size() const noexcept -> std::size_t;
+
+    // drop all buffered inputs
+    inline void reset() noexcept;
+
+    // appends count input samples and writes all outputs that became available, returns the end of the output
+    template <class InputIterator, class OutputIterator>
+    auto process(InputIterator src, std::size_t count, OutputIterator dst) -> OutputIterator;
+
+private:
+    std::size_t         factor_;
+    std::vector<real_t> coefficients_;      // one block of taps_per_phase coefficients per phase
+    std::vector<real_t> history_;
+    std::vector<real_t> phases_;
+    std::vector<real_t> output_;
+};
+
+
+template <class real_t>
+constexpr std::size_t polyphase_decimator<real_t>::taps_per_phase;
+
+template <class real_t>
+polyphase_decimator<real_t>::polyphase_decimator(std::size_t factor)
+        : factor_{factor}
+        , coefficients_(factor * taps_per_phase)
+        , history_{}
+        , phases_{}
+        , output_{}
+{
+    if (factor < 2)
+        throw std::invalid_argument("The polyphase decimator requires a factor of at least two!");
+
+    auto const n      = factor * taps_per_phase;
+    auto const center = static_cast<double>(n - 1) / 2.0;
+
+    auto h = std::vector<double>(n);
+    auto sum = 0.0;
+
+    for (std::size_t t = 0; t < n; t++) {
+        auto const x = math::pi<double> * (static_cast<double>(t) - center) / factor;
+        auto const w = 0.42 - 0.5 * std::cos(2.0 * math::pi<double> * t / (n - 1))
+                + 0.08 * std::cos(4.0 * math::pi<double> * t / (n - 1));
+
+        h[t] = (x == 0.0 ? 1.0 : std::sin(x) / x) * w;
+        sum += h[t];
+    }
+
+    // unit gain at DC, coefficient t belongs to phase t % factor
+    for (std::size_t t = 0; t < n; t++)
+        coefficients_[(t % factor) * taps_per_phase + t / factor] = static_cast<real_t>(h[t] / sum);
+}
+
+template <class real_t>
+auto polyphase_decimator<real_t>::factor() const noexcept -> std::size_t {
+    return factor_;
+}
+
+template <class real_t>
+auto polyphase_decimator<real_t>::filter_size() const noexcept -> std::size_t {
+    return factor_ * taps_per_phase;
+}
+
+template <class real_t>
+void polyphase_decimator<real_t>::reset() noexcept {
+    history_.clear();
+}
+
+template <class real_t>
+template <class InputIterator, class OutputIterator>
+auto polyphase_decimator<real_t>::process(InputIterator src, std::size_t count, OutputIterator dst)
+        -> OutputIterator
+{
+    history_.insert(history_.end(), src, std::next(src, count));
+
+    // output j is computed from the inputs j factor to j factor + filter_size() - 1
+    auto const n = filter_size();
+    if (history_.size() < n)
+        return dst;
+
+    auto const outputs = (history_.size() - n) / factor_ + 1;
+    auto const stride  = outputs + taps_per_phase - 1;
+
+    // split the required inputs into the phases
+    phases_.resize(factor_ * stride);
+    for (std::size_t p = 0; p < factor_; p++) {
+        for (std::size_t j = 0; j < stride; j++)
+            phases_[p * stride + j] = history_[j * factor_ + p];
+    }
+
+    output_.resize(outputs);
+
+    static auto const fn = polyphase_kernels::select_decimate<real_t>();
+    fn(phases_.data(), stride, output_.data(), outputs, coefficients_.data(), factor_, taps_per_phase);
+
+    history_.erase(history_.begin(), history_.begin() + outputs * factor_);
+
+    return std::copy(output_.begin(), output_.end(), dst);
+}
+
+} /* namespace audio */
+} /* namespace avis */
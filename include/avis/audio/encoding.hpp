@@ -0,0 +1,192 @@
+#pragma once
+
+#include <avis/audio/fft/kernels.hpp>
+#include <avis/utils/cpu.hpp>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+
+
+namespace avis {
+namespace audio {
+
+// Encoding of spectrum rows for upload: linear magnitudes as 32 bit float, or the magnitude in dB mapped linearly
+// from [min, max] to [0, 1] and stored as 16 bit float or 8 bit normalized integer.
+enum class spectrum_encoding {
+    linear_f32,
+    db_f16,
+    db_u8,
+};
+
+struct db_range {
+    float min;
+    float max;
+};
+
+constexpr auto encoded_bin_size(spectrum_encoding enc) noexcept -> std::size_t {
+    return enc == spectrum_encoding::linear_f32 ? 4 : enc == spectrum_encoding::db_f16 ? 2 : 1;
+}
+
+
+namespace encoding {
+
+// 20 log10(x) = 20 log10(2) log2(x)
+constexpr float db_per_log2 = 6.02059991f;
+
+// Values below this are clamped to avoid log2(0), i.e. -240 dB.
+constexpr float min_magnitude = 1e-12f;
+
+// Approximation of log2(x) for positive normal x: the exponent is extracted from the representation, log2 of the
+// mantissa m in [1, 2) is approximated by a polynomial of fourth degree (absolute error below 1e-4).
+inline auto fast_log2(float x) noexcept -> float {
+    std::uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+
+    auto const e = static_cast<float>(static_cast<std::int32_t>(bits >> 23) - 127);
+
+    bits = (bits & 0x007fffff) | 0x3f800000;
+    float m;
+    std::memcpy(&m, &bits, sizeof(m));
+
+    auto const p = -2.51299411f + (4.07048265f + (-2.12107958f + (0.645324281f - 0.0816459334f * m) * m) * m) * m;
+    return e + p;
+}
+
+// Conversion to IEEE 754 half precision with round-to-nearest-even, including subnormals and infinity/NaN.
+inline auto float_to_half(float x) noexcept -> std::uint16_t {
+    std::uint32_t f;
+    std::memcpy(&f, &x, sizeof(f));
+
+    auto const sign = f & 0x80000000;
+    f ^= sign;
+
+    std::uint32_t h;
+    if (f >= 0x47800000) {                      // overflow, infinity or NaN
+        h = f > 0x7f800000 ? 0x7e00 : 0x7c00;
+    } else if (f < 0x38800000) {                // subnormal or zero: let the FPU do the rounding
+        float v;
+        std::memcpy(&v, &f, sizeof(v));
+        v += 0.5f;
+
+        std::memcpy(&h, &v, sizeof(h));
+        h -= 0x3f000000;
+    } else {                                    // normal: re-bias exponent, round mantissa
+        auto const odd = (f >> 13) & 1;
+        f += 0xc8000fff + odd;
+        h = f >> 13;
+    }
+
+    return static_cast<std::uint16_t>(h | (sign >> 16));
+}
+
+inline auto db_level(float magnitude, float offset, float factor) noexcept -> float {
+    auto const db = db_per_log2 * fast_log2(std::max(magnitude, min_magnitude));
+    return std::min(std::max((db - offset) * factor, 0.0f), 1.0f);
+}
+
+inline void encode_scalar(float const* src, void* dst, std::size_t n, spectrum_encoding enc, db_range range) {
+    auto const factor = 1.0f / (range.max - range.min);
+
+    switch (enc) {
+    case spectrum_encoding::linear_f32:
+        std::memcpy(dst, src, n * sizeof(float));
+        break;
+
+    case spectrum_encoding::db_f16:
+        for (std::size_t i = 0; i < n; i++)
+            static_cast<std::uint16_t*>(dst)[i] = float_to_half(db_level(src[i], range.min, factor));
+        break;
+
+    case spectrum_encoding::db_u8:
+        for (std::size_t i = 0; i < n; i++)
+            static_cast<std::uint8_t*>(dst)[i] = static_cast<std::uint8_t>(db_level(src[i], range.min, factor) * 255.0f + 0.5f);
+        break;
+    }
+}
+
+
+#ifdef AVIS_AUDIO_FFT_X86_KERNELS
+
+__attribute__((target("avx2,fma,f16c")))
+inline auto db_level_avx2(__m256 x, __m256 offset, __m256 factor) noexcept -> __m256 {
+    x = _mm256_max_ps(x, _mm256_set1_ps(min_magnitude));
+
+    auto const bits = _mm256_castps_si256(x);
+    auto const e = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127)));
+    auto const m = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007fffff)),
+            _mm256_set1_epi32(0x3f800000)));
+
+    auto p = _mm256_set1_ps(-0.0816459334f);
+    p = _mm256_fmadd_ps(p, m, _mm256_set1_ps(0.645324281f));
+    p = _mm256_fmadd_ps(p, m, _mm256_set1_ps(-2.12107958f));
+    p = _mm256_fmadd_ps(p, m, _mm256_set1_ps(4.07048265f));
+    p = _mm256_fmadd_ps(p, m, _mm256_set1_ps(-2.51299411f));
+
+    auto const db = _mm256_mul_ps(_mm256_add_ps(e, p), _mm256_set1_ps(db_per_log2));
+    auto const level = _mm256_mul_ps(_mm256_sub_ps(db, offset), factor);
+
+    return _mm256_min_ps(_mm256_max_ps(level, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+}
+
+__attribute__((target("avx2,fma,f16c")))
+inline void encode_avx2(float const* src, void* dst, std::size_t n, spectrum_encoding enc, db_range range) {
+    if (enc == spectrum_encoding::linear_f32) {
+        std::memcpy(dst, src, n * sizeof(float));
+        return;
+    }
+
+    auto const offset = _mm256_set1_ps(range.min);
+    auto const factor = _mm256_set1_ps(1.0f / (range.max - range.min));
+
+    std::size_t i = 0;
+    if (enc == spectrum_encoding::db_f16) {
+        auto const out = static_cast<std::uint16_t*>(dst);
+
+        for (; i + 8 <= n; i += 8) {
+            auto const level = db_level_avx2(_mm256_loadu_ps(src + i), offset, factor);
+            auto const half  = _mm256_cvtps_ph(level, _MM_FROUND_TO_NEAREST_INT);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), half);
+        }
+    } else {
+        auto const out = static_cast<std::uint8_t*>(dst);
+
+        for (; i + 8 <= n; i += 8) {
+            auto const level = db_level_avx2(_mm256_loadu_ps(src + i), offset, factor);
+            auto const v32 = _mm256_cvtps_epi32(_mm256_mul_ps(level, _mm256_set1_ps(255.0f)));
+            auto const v16 = _mm_packus_epi32(_mm256_castsi256_si128(v32), _mm256_extracti128_si256(v32, 1));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(v16, v16));
+        }
+    }
+
+    // remainder
+    auto const remaining = n - i;
+    auto const offset_bytes = i * encoded_bin_size(enc);
+    encode_scalar(src + i, static_cast<std::uint8_t*>(dst) + offset_bytes, remaining, enc, range);
+}
+
+#endif /* AVIS_AUDIO_FFT_X86_KERNELS */
+
+using encode_fn = void (*)(float const* src, void* dst, std::size_t n, spectrum_encoding enc, db_range range);
+
+inline auto select_encode() noexcept -> encode_fn {
+#ifdef AVIS_AUDIO_FFT_X86_KERNELS
+    auto const& cpu = utils::get_cpu_features();
+    if (cpu.avx2 && cpu.fma && cpu.f16c)
+        return encode_avx2;
+#endif
+
+    return encode_scalar;
+}
+
+} /* namespace encoding */
+
+
+// Encode a row of n linear magnitudes into dst, which must provide n * encoded_bin_size(enc) bytes.
+inline void encode_spectrum(float const* src, void* dst, std::size_t n, spectrum_encoding enc, db_range range) {
+    static auto const fn = encoding::select_encode();
+    fn(src, dst, n, enc, range);
+}
+
+} /* namespace audio */
+} /* namespace avis */
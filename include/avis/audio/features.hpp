@@ -0,0 +1,309 @@
+#pragma once
+
+#include <avis/audio/fft.hpp>
+#include <avis/audio/fft/kernels.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+
+namespace avis {
+namespace audio {
+
+// Scalar features of one spectrum: RMS level of the analysed samples, spectral centroid and rolloff (in Hz), spectral
+// flux (L2 norm of the magnitude difference to the previous spectrum) and onset strength (sum of the magnitude
+// increases to the previous spectrum, i.e. half-wave rectified flux).
+struct spectral_features {
+    float rms;
+    float centroid;
+    float rolloff;
+    float flux;
+    float onset;
+};
+
+
+namespace features_kernels {
+
+// Sums over the bins of one spectrum: magnitudes, magnitudes weighted by the bin index, energies, squared and
+// positive magnitude differences to the previous spectrum.
+template <class real_t>
+struct sums {
+    real_t magnitude;
+    real_t weighted;
+    real_t energy;
+    real_t difference;
+    real_t increase;
+};
+
+// Accumulate the sums of n values in the given magnitude mode (power or magnitude), replacing the previous
+// magnitudes by the current ones in the same pass.
+template <class real_t>
+using accumulate_fn = sums<real_t> (*)(real_t const* src, real_t* previous, std::size_t n, bool power);
+
+template <class real_t>
+inline void accumulate_tail(real_t const* src, real_t* previous, std::size_t i, std::size_t n, bool power,
+        sums<real_t>& s)
+{
+    for (; i < n; i++) {
+        auto const m = power ? std::sqrt(src[i]) : src[i];
+        auto const d = m - previous[i];
+
+        s.magnitude  += m;
+        s.weighted   += static_cast<real_t>(i) * m;
+        s.energy     += power ? src[i] : m * m;
+        s.difference += d * d;
+        s.increase   += std::max(d, real_t{0});
+
+        previous[i] = m;
+    }
+}
+
+template <class real_t>
+inline auto accumulate_scalar(real_t const* src, real_t* previous, std::size_t n, bool power) -> sums<real_t> {
+    auto s = sums<real_t>{0, 0, 0, 0, 0};
+    accumulate_tail(src, previous, 0, n, power, s);
+    return s;
+}
+
+
+#ifdef AVIS_AUDIO_FFT_X86_KERNELS
+
+__attribute__((target("avx2,fma")))
+inline auto reduce_avx2(__m256 v) -> float {
+    auto sum4 = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    sum4 = _mm_add_ps(sum4, _mm_movehl_ps(sum4, sum4));
+    sum4 = _mm_add_ss(sum4, _mm_shuffle_ps(sum4, sum4, 1));
+    return _mm_cvtss_f32(sum4);
+}
+
+__attribute__((target("avx2,fma")))
+inline auto accumulate_avx2(float const* src, float* previous, std::size_t n, bool power) -> sums<float> {
+    auto const zero = _mm256_setzero_ps();
+    auto const step = _mm256_set1_ps(8.0f);
+
+    auto index      = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+    auto magnitude  = zero;
+    auto weighted   = zero;
+    auto energy     = zero;
+    auto difference = zero;
+    auto increase   = zero;
+
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto const v = _mm256_loadu_ps(src + i);
+        auto const m = power ? _mm256_sqrt_ps(v) : v;
+        auto const d = _mm256_sub_ps(m, _mm256_loadu_ps(previous + i));
+
+        magnitude  = _mm256_add_ps(magnitude, m);
+        weighted   = _mm256_fmadd_ps(index, m, weighted);
+        energy     = power ? _mm256_add_ps(energy, v) : _mm256_fmadd_ps(m, m, energy);
+        difference = _mm256_fmadd_ps(d, d, difference);
+        increase   = _mm256_add_ps(increase, _mm256_max_ps(d, zero));
+
+        _mm256_storeu_ps(previous + i, m);
+        index = _mm256_add_ps(index, step);
+    }
+
+    auto s = sums<float>{reduce_avx2(magnitude), reduce_avx2(weighted), reduce_avx2(energy),
+            reduce_avx2(difference), reduce_avx2(increase)};
+
+    accumulate_tail(src, previous, i, n, power, s);
+    return s;
+}
+
+__attribute__((target("avx512f")))
+inline auto reduce_avx512(__m512 v) -> float {
+    v = _mm512_add_ps(v, _mm512_maskz_shuffle_f32x4(0xffff, v, v, 0x4e));
+    v = _mm512_add_ps(v, _mm512_maskz_shuffle_f32x4(0xffff, v, v, 0xb1));
+
+    auto sum4 = _mm512_maskz_extractf32x4_ps(0xf, v, 0);
+    sum4 = _mm_add_ps(sum4, _mm_movehl_ps(sum4, sum4));
+    sum4 = _mm_add_ss(sum4, _mm_shuffle_ps(sum4, sum4, 1));
+    return _mm_cvtss_f32(sum4);
+}
+
+__attribute__((target("avx512f")))
+inline auto accumulate_avx512(float const* src, float* previous, std::size_t n, bool power) -> sums<float> {
+    auto const zero = _mm512_setzero_ps();
+    auto const step = _mm512_set1_ps(16.0f);
+
+    auto index      = _mm512_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f,
+                                     8.0f, 9.0f, 10.0f, 11.0f, 12.0f, 13.0f, 14.0f, 15.0f);
+    auto magnitude  = zero;
+    auto weighted   = zero;
+    auto energy     = zero;
+    auto difference = zero;
+    auto increase   = zero;
+
+    // the remainder uses masked loads and stores, masked lanes are zero and do not contribute
+    for (std::size_t i = 0; i < n; i += 16) {
+        auto const mask = static_cast<__mmask16>(n - i >= 16 ? 0xffff : (1u << (n - i)) - 1);
+
+        auto const v = _mm512_maskz_loadu_ps(mask, src + i);
+        auto const m = power ? _mm512_maskz_sqrt_ps(0xffff, v) : v;
+        auto const d = _mm512_sub_ps(m, _mm512_maskz_loadu_ps(mask, previous + i));
+
+        magnitude  = _mm512_add_ps(magnitude, m);
+        weighted   = _mm512_fmadd_ps(index, m, weighted);
+        energy     = power ? _mm512_add_ps(energy, v) : _mm512_fmadd_ps(m, m, energy);
+        difference = _mm512_fmadd_ps(d, d, difference);
+        increase   = _mm512_add_ps(increase, _mm512_maskz_max_ps(0xffff, d, zero));
+
+        _mm512_mask_storeu_ps(previous + i, mask, m);
+        index = _mm512_add_ps(index, step);
+    }
+
+    return {reduce_avx512(magnitude), reduce_avx512(weighted), reduce_avx512(energy), reduce_avx512(difference),
+            reduce_avx512(increase)};
+}
+
+#endif /* AVIS_AUDIO_FFT_X86_KERNELS */
+
+template <class real_t>
+inline auto select_accumulate() noexcept -> accumulate_fn<real_t> {
+    return accumulate_scalar<real_t>;
+}
+
+template <>
+inline auto select_accumulate<float>() noexcept -> accumulate_fn<float> {
+    switch (fft::get_kernel_isa()) {
+#ifdef AVIS_AUDIO_FFT_X86_KERNELS
+    case fft::kernel_isa::avx512:   return accumulate_avx512;
+    case fft::kernel_isa::avx2:     return accumulate_avx2;
+#endif
+    default:                        return accumulate_scalar<float>;
+    }
+}
+
+} /* namespace features_kernels */
+
+
+// Streaming extraction of spectral_features from the n/2 + 1 bins of consecutive n-point real FFTs (Hann window, in
+// the scale of fft_plan), in the magnitude mode of the plan. All sums are collected in a single pass over the bins,
+// which also keeps the magnitudes as reference for the flux of the next spectrum, only the rolloff takes a second
+// pass over the (cached) magnitudes. The RMS level is derived from the spectrum via Parseval's theorem and
+// compensated for the window.
+template <class real_t = float>
+class feature_extractor {
+public:
+    // fraction of the sum of magnitudes below the rolloff frequency
+    static constexpr double rolloff_fraction = 0.85;
+
+    feature_extractor()
+            : size_{0}
+            , bin_width_{0}
+            , mode_{magnitude_mode::magnitude}
+            , previous_{} {}
+
+    inline feature_extractor(std::size_t n, double sample_rate);
+
+    inline auto input_size() const noexcept -> std::size_t;
+
+    inline auto get_magnitude_mode() const noexcept -> magnitude_mode;
+    inline void set_magnitude_mode(magnitude_mode mode) noexcept;
+
+    // features of the next spectrum, the flux is relative to the previous spectrum passed to apply or set_reference
+    inline auto apply(real_t const* src) -> spectral_features;
+
+    // use the given spectrum as previous one without computing its features, e.g. when continuing after a
+    // spectrum processed by another extractor
+    inline void set_reference(real_t const* src);
+
+    // reset the previous spectrum to silence
+    inline void reset() noexcept;
+
+private:
+    inline auto accumulate(real_t const* src) -> features_kernels::sums<real_t>;
+
+    std::size_t         size_;
+    real_t              bin_width_;
+    magnitude_mode      mode_;
+    std::vector<real_t> previous_;      // magnitudes of the previous spectrum
+};
+
+
+template <class real_t>
+constexpr double feature_extractor<real_t>::rolloff_fraction;
+
+template <class real_t>
+feature_extractor<real_t>::feature_extractor(std::size_t n, double sample_rate)
+        : size_{n}
+        , bin_width_{static_cast<real_t>(sample_rate / n)}
+        , mode_{magnitude_mode::magnitude}
+        , previous_(rfft_output_size(n))
+{
+    if (n < 2 || n % 2 != 0)
+        throw std::invalid_argument("The feature extractor requires N to be even!");
+}
+
+template <class real_t>
+auto feature_extractor<real_t>::input_size() const noexcept -> std::size_t {
+    return previous_.size();
+}
+
+template <class real_t>
+auto feature_extractor<real_t>::get_magnitude_mode() const noexcept -> magnitude_mode {
+    return mode_;
+}
+
+template <class real_t>
+void feature_extractor<real_t>::set_magnitude_mode(magnitude_mode mode) noexcept {
+    mode_ = mode;
+}
+
+template <class real_t>
+auto feature_extractor<real_t>::accumulate(real_t const* src) -> features_kernels::sums<real_t> {
+    static auto const fn = features_kernels::select_accumulate<real_t>();
+    return fn(src, previous_.data(), previous_.size(), mode_ == magnitude_mode::power);
+}
+
+template <class real_t>
+auto feature_extractor<real_t>::apply(real_t const* src) -> spectral_features {
+    auto const s = accumulate(src);
+
+    // Parseval: the n bins of the full spectrum sum up to the energy of the windowed samples, DC and Nyquist bins
+    // occur once, all others twice, the mean square of the Hann window is 3/8
+    auto const dc      = previous_.front() * previous_.front();
+    auto const nyquist = previous_.back() * previous_.back();
+    auto const energy  = std::max(2 * s.energy - dc - nyquist, real_t{0});
+
+    auto const rms = std::sqrt(energy / (real_t{3} / real_t{8} * size_));
+
+    // rolloff: first bin at which the cumulative sum of magnitudes reaches the given fraction
+    auto const threshold = static_cast<real_t>(rolloff_fraction) * s.magnitude;
+    auto cumulative = real_t{0};
+    auto rolloff    = std::size_t{0};
+
+    while (rolloff + 1 < previous_.size()) {
+        cumulative += previous_[rolloff];
+        if (cumulative >= threshold)
+            break;
+
+        rolloff++;
+    }
+
+    auto const centroid = s.magnitude > real_t{0} ? bin_width_ * s.weighted / s.magnitude : real_t{0};
+
+    return {
+        static_cast<float>(rms),
+        static_cast<float>(centroid),
+        static_cast<float>(bin_width_ * rolloff),
+        static_cast<float>(std::sqrt(s.difference)),
+        static_cast<float>(s.increase),
+    };
+}
+
+template <class real_t>
+void feature_extractor<real_t>::set_reference(real_t const* src) {
+    accumulate(src);
+}
+
+template <class real_t>
+void feature_extractor<real_t>::reset() noexcept {
+    std::fill(previous_.begin(), previous_.end(), real_t{0});
+}
+
+} /* namespace audio */
+} /* namespace avis */
@@ -1,10 +1,21 @@
 #pragma once
 
+#include <avis/audio/fft/kernels.hpp>
+#include <avis/audio/fft/complex_plan.hpp>
+#include <avis/audio/fft/four_step.hpp>
+#include <avis/audio/fft/real.hpp>
+#include <avis/utils/aligned_buffer.hpp>
 #include <avis/utils/constexpr_math.hpp>
 
 #include <array>
 #include <complex>
+#include <cmath>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 
 namespace avis {
@@ -80,41 +91,832 @@ constexpr auto fft_root_table() -> std::array<std::complex<real_t>, N/2> {
 }
 
 
-template<std::size_t N, class InputIterator, class OutputIterator, class real_t = typename std::iterator_traits<InputIterator>::value_type>
-void rfft(InputIterator src, OutputIterator dst) {
-    static_assert(bitcount(N) == 1, "This FFT implementation requires N to be a power of two!");
+template <class real_t>
+constexpr auto fft_stage_root_table_arg(std::size_t i) -> real_t {
+    std::size_t h = 1;
+    while (2 * h <= i + 1)
+        h *= 2;
+
+    return math::pi<real_t> * (i + 1 - h) / h;
+}
+
+template <class real_t>
+constexpr auto fft_stage_root_table_entry_re(std::size_t i) -> real_t {
+    return math::cxpr::cos(fft_stage_root_table_arg<real_t>(i));
+}
+
+template <class real_t>
+constexpr auto fft_stage_root_table_entry_im(std::size_t i) -> real_t {
+    return -math::cxpr::sin(fft_stage_root_table_arg<real_t>(i));
+}
+
+template <std::size_t N, class real_t>
+constexpr auto fft_stage_root_table_re() -> std::array<real_t, N - 1> {
+    return make_array<N - 1>(fft_stage_root_table_entry_re<real_t>);
+}
+
+template <std::size_t N, class real_t>
+constexpr auto fft_stage_root_table_im() -> std::array<real_t, N - 1> {
+    return make_array<N - 1>(fft_stage_root_table_entry_im<real_t>);
+}
+
+
+constexpr auto rfft_output_size(std::size_t n) -> std::size_t {
+    return n / 2 + 1;
+}
+
+
+template <std::size_t N, class real_t = float>
+class fft_plan {
+    static_assert(N >= 4, "This FFT implementation requires N to be at least four!");
+
+public:
+    static constexpr std::size_t input_size  = N;
+    static constexpr std::size_t output_size = rfft_output_size(N);
+
+    inline fft_plan();
+
+    inline auto get_magnitude_mode() const noexcept -> magnitude_mode;
+    inline void set_magnitude_mode(magnitude_mode mode) noexcept;
+
+    template <class InputIterator, class OutputIterator>
+    void execute(InputIterator src, OutputIterator dst);
+
+    // transform without taking the norm: writes the n/2 + 1 complex bins, in the same scale as the magnitudes
+    template <class InputIterator>
+    void execute_spectrum(InputIterator src, std::complex<real_t>* dst);
+
+    template <class InputIterator, class OutputIterator>
+    void execute_batch(InputIterator src, OutputIterator dst, std::size_t count, std::ptrdiff_t stride);
+
+    template <class InputIterator, class OutputIterator>
+    void execute_batch(InputIterator src, OutputIterator dst, std::size_t count, std::ptrdiff_t stride,
+            std::size_t hop);
+
+    // transform both channels of stereo input at once, see fft::pack_stereo_split
+    template <class InputIterator, class OutputIterator>
+    void execute_stereo(InputIterator left, InputIterator right, OutputIterator dst_left, OutputIterator dst_right);
+
+    template <class InputIterator, class OutputIterator>
+    void execute_stereo_batch(InputIterator left, InputIterator right, OutputIterator dst_left,
+            OutputIterator dst_right, std::size_t count, std::ptrdiff_t stride, std::size_t hop);
+
+    // transform count rows of each of the channels, channels are paired into stereo transforms
+    template <class InputIterator, class OutputIterator>
+    void execute_multichannel_batch(InputIterator const* src, OutputIterator const* dst, std::size_t channels,
+            std::size_t count, std::ptrdiff_t stride, std::size_t hop);
+
+private:
+    // powers of two use the radix-2 kernels on split data, all other sizes use the mixed-radix/Bluestein plan
+    using is_radix2 = std::integral_constant<bool, bitcount(N) == 1>;
+
+    // size of the complex transform: real input is packed into N/2 complex values if N is even
+    static constexpr std::size_t M = N % 2 == 0 ? N / 2 : N;
+
+    // large powers of two use the Stockham kernels, avoiding the bit-reversal scatter of the input, very large ones
+    // are decomposed into cache-sized sub-transforms
+    static constexpr bool stockham  = is_radix2::value && fft::use_stockham(M);
+    static constexpr bool four_step = is_radix2::value && fft::use_four_step(M);
+
+    // stereo input is transformed using one complex FFT of size N
+    static constexpr bool stereo_stockham  = is_radix2::value && fft::use_stockham(N);
+    static constexpr bool stereo_four_step = is_radix2::value && fft::use_four_step(N);
+
+    // the four-step transforms generate their tables on construction: constant expression tables of this size would
+    // take too long to compile
+    struct four_step_path {};
+
+    using path        = typename std::conditional<four_step, four_step_path, is_radix2>::type;
+    using stereo_path = typename std::conditional<stereo_four_step, four_step_path, is_radix2>::type;
+
+    // transform the windowed input, the result is passed to unpack(z, roots, scale)
+    template <class InputIterator, class Unpack>
+    void transform(InputIterator src, Unpack unpack, std::true_type);
+
+    template <class InputIterator, class Unpack>
+    void transform(InputIterator src, Unpack unpack, std::false_type);
+
+    template <class InputIterator, class Unpack>
+    void transform(InputIterator src, Unpack unpack, four_step_path);
+
+    template <class InputIterator, class OutputIterator>
+    void execute_stereo(InputIterator left, InputIterator right, OutputIterator dst_left, OutputIterator dst_right,
+            std::true_type);
+
+    template <class InputIterator, class OutputIterator>
+    void execute_stereo(InputIterator left, InputIterator right, OutputIterator dst_left, OutputIterator dst_right,
+            std::false_type);
+
+    template <class InputIterator, class OutputIterator>
+    void execute_stereo(InputIterator left, InputIterator right, OutputIterator dst_left, OutputIterator dst_right,
+            four_step_path);
+
+    utils::aligned_buffer<real_t>               buffer_re_;
+    utils::aligned_buffer<real_t>               buffer_im_;
+    utils::aligned_buffer<real_t>               buffer_tmp_re_;
+    utils::aligned_buffer<real_t>               buffer_tmp_im_;
+    fft::four_step_plan<real_t>                 four_step_;
+
+    fft::complex_plan<real_t>                   generic_;
+    utils::aligned_buffer<std::complex<real_t>> buffer_in_;
+    utils::aligned_buffer<std::complex<real_t>> buffer_out_;
+
+    utils::aligned_buffer<real_t>               stereo_re_;
+    utils::aligned_buffer<real_t>               stereo_im_;
+    utils::aligned_buffer<real_t>               stereo_tmp_re_;
+    utils::aligned_buffer<real_t>               stereo_tmp_im_;
+    fft::four_step_plan<real_t>                 stereo_four_step_;
+    fft::complex_plan<real_t>                   stereo_generic_;
+    utils::aligned_buffer<std::complex<real_t>> stereo_in_;
+    utils::aligned_buffer<std::complex<real_t>> stereo_out_;
+
+    std::vector<real_t>                         window_;        // tables of the four-step transforms
+    std::vector<std::complex<real_t>>           roots_;
+
+    magnitude_mode                              mode_;
+    utils::aligned_buffer<real_t>               buffer_norm_;
+};
+
+
+template <std::size_t N, class real_t>
+constexpr std::size_t fft_plan<N, real_t>::input_size;
+
+template <std::size_t N, class real_t>
+constexpr std::size_t fft_plan<N, real_t>::output_size;
+
+template <std::size_t N, class real_t>
+constexpr std::size_t fft_plan<N, real_t>::M;
+
+template <std::size_t N, class real_t>
+constexpr bool fft_plan<N, real_t>::stockham;
+
+template <std::size_t N, class real_t>
+constexpr bool fft_plan<N, real_t>::four_step;
+
+template <std::size_t N, class real_t>
+constexpr bool fft_plan<N, real_t>::stereo_stockham;
+
+template <std::size_t N, class real_t>
+constexpr bool fft_plan<N, real_t>::stereo_four_step;
+
+template <std::size_t N, class real_t>
+fft_plan<N, real_t>::fft_plan()
+        : buffer_re_{is_radix2::value ? M : 0}
+        , buffer_im_{is_radix2::value ? M : 0}
+        , buffer_tmp_re_{stockham || four_step ? M : 0}
+        , buffer_tmp_im_{stockham || four_step ? M : 0}
+        , four_step_{}
+        , generic_{}
+        , buffer_in_{is_radix2::value ? 0 : M}
+        , buffer_out_{is_radix2::value ? 0 : M}
+        , stereo_re_{is_radix2::value ? N : 0}
+        , stereo_im_{is_radix2::value ? N : 0}
+        , stereo_tmp_re_{stereo_stockham || stereo_four_step ? N : 0}
+        , stereo_tmp_im_{stereo_stockham || stereo_four_step ? N : 0}
+        , stereo_four_step_{}
+        , stereo_generic_{}
+        , stereo_in_{is_radix2::value ? 0 : N}
+        , stereo_out_{is_radix2::value ? 0 : N}
+        , window_{}
+        , roots_{}
+        , mode_{magnitude_mode::magnitude}
+        , buffer_norm_{2 * output_size}
+{
+    if (!is_radix2::value) {
+        generic_        = fft::complex_plan<real_t>{M};
+        stereo_generic_ = fft::complex_plan<real_t>{N};
+    }
+
+    if (stereo_four_step) {
+        stereo_four_step_ = fft::four_step_plan<real_t>{N};
+
+        window_.resize(N);
+        for (std::size_t i = 0; i < N; i++)
+            window_[i] = static_cast<real_t>(0.5 * (1.0 - std::cos((2.0 * math::pi<double> * i) / (N - 1.0))));
+    }
+
+    if (four_step) {
+        four_step_ = fft::four_step_plan<real_t>{M};
+
+        roots_.resize(N / 2);
+        for (std::size_t k = 0; k < N / 2; k++) {
+            double const arg = 2.0 * math::pi<double> * k / N;
+            roots_[k] = {static_cast<real_t>(std::cos(arg)), static_cast<real_t>(-std::sin(arg))};
+        }
+    }
+}
+
+template <std::size_t N, class real_t>
+auto fft_plan<N, real_t>::get_magnitude_mode() const noexcept -> magnitude_mode {
+    return mode_;
+}
+
+template <std::size_t N, class real_t>
+void fft_plan<N, real_t>::set_magnitude_mode(magnitude_mode mode) noexcept {
+    mode_ = mode;
+}
+
+template <std::size_t N, class real_t>
+template <class InputIterator, class OutputIterator>
+void fft_plan<N, real_t>::execute(InputIterator src, OutputIterator dst) {
+    transform(src, [&](auto z, std::complex<real_t> const* roots, real_t scale) {
+        fft::unpack_magnitude(z, roots, N, scale, mode_, buffer_norm_.data(), dst);
+    }, path{});
+}
+
+template <std::size_t N, class real_t>
+template <class InputIterator>
+void fft_plan<N, real_t>::execute_spectrum(InputIterator src, std::complex<real_t>* dst) {
+    transform(src, [&](auto z, std::complex<real_t> const* roots, real_t scale) {
+        fft::unpack_norm(z, roots, N, fft::norm_complex<real_t>{scale}, dst);
+    }, path{});
+}
+
+template <std::size_t N, class real_t>
+template <class InputIterator, class Unpack>
+void fft_plan<N, real_t>::transform(InputIterator src, Unpack unpack, std::true_type) {
+    constexpr static auto lut_shuffle  = io_shuffle_table<M>();
+    constexpr static auto lut_window   = hanning_window_table<N, real_t>();
+    constexpr static auto lut_roots    = fft_root_table<N, real_t>();
+    constexpr static auto lut_stage_re = fft_stage_root_table_re<M, real_t>();
+    constexpr static auto lut_stage_im = fft_stage_root_table_im<M, real_t>();
+
+    constexpr static auto scale = static_cast<real_t>(1.0 / math::cxpr::sqrt(static_cast<real_t>(N)));
+
+    auto const buffer_re = buffer_re_.data();
+    auto const buffer_im = buffer_im_.data();
+
+    if (stockham) {
+        // the roots W_M^j of the last radix-2 stage are the twiddles of the Stockham stages
+        fft::pack_split(src, lut_window.data(), buffer_re, buffer_im, N);
+        fft::kernels<real_t>::stockham()(buffer_re, buffer_im, buffer_tmp_re_.data(), buffer_tmp_im_.data(),
+                lut_stage_re.data() + M / 2 - 1, lut_stage_im.data() + M / 2 - 1, M);
+    } else {
+        fft::pack_shuffled(src, lut_window.data(), lut_shuffle.data(), buffer_re, buffer_im, N);
+        fft::kernels<real_t>::radix2()(buffer_re, buffer_im, lut_stage_re.data(), lut_stage_im.data(), M);
+    }
+
+    auto const z = [&](std::size_t k) { return std::complex<real_t>{buffer_re[k], buffer_im[k]}; };
+    unpack(z, lut_roots.data(), scale);
+}
+
+template <std::size_t N, class real_t>
+template <class InputIterator, class Unpack>
+void fft_plan<N, real_t>::transform(InputIterator src, Unpack unpack, std::false_type) {
+    constexpr static auto lut_window = hanning_window_table<N, real_t>();
+    constexpr static auto lut_roots  = fft_root_table<N, real_t>();
+
+    constexpr static auto scale = static_cast<real_t>(1.0 / math::cxpr::sqrt(static_cast<real_t>(N)));
+
+    auto const buffer_in  = buffer_in_.data();
+    auto const buffer_out = buffer_out_.data();
+
+    fft::pack_complex(src, lut_window.data(), buffer_in, N);
+    generic_.execute(buffer_in, buffer_out);
+
+    auto const z = [&](std::size_t k) { return buffer_out[k]; };
+    unpack(z, lut_roots.data(), scale);
+}
+
+template <std::size_t N, class real_t>
+template <class InputIterator, class Unpack>
+void fft_plan<N, real_t>::transform(InputIterator src, Unpack unpack, four_step_path) {
+    constexpr static auto scale = static_cast<real_t>(1.0 / math::cxpr::sqrt(static_cast<real_t>(N)));
+
+    auto const buffer_re = buffer_tmp_re_.data();
+    auto const buffer_im = buffer_tmp_im_.data();
+
+    fft::pack_split(src, window_.data(), buffer_re_.data(), buffer_im_.data(), N);
+    four_step_.execute(buffer_re_.data(), buffer_im_.data(), buffer_re, buffer_im);
+
+    auto const z = [&](std::size_t k) { return std::complex<real_t>{buffer_re[k], buffer_im[k]}; };
+    unpack(z, roots_.data(), scale);
+}
+
+template <std::size_t N, class real_t>
+template <class InputIterator, class OutputIterator>
+void fft_plan<N, real_t>::execute_batch(InputIterator src, OutputIterator dst, std::size_t count,
+        std::ptrdiff_t stride)
+{
+    execute_batch(src, dst, count, stride, N);
+}
+
+template <std::size_t N, class real_t>
+template <class InputIterator, class OutputIterator>
+void fft_plan<N, real_t>::execute_batch(InputIterator src, OutputIterator dst, std::size_t count,
+        std::ptrdiff_t stride, std::size_t hop)
+{
+    // chunks of N samples start every hop samples in src (overlapping if hop < N), output rows start every
+    // stride elements in dst
+    for (std::size_t i = 0; i < count; i++)
+        execute(std::next(src, hop * i), std::next(dst, stride * static_cast<std::ptrdiff_t>(i)));
+}
+
+template <std::size_t N, class real_t>
+template <class InputIterator, class OutputIterator>
+void fft_plan<N, real_t>::execute_stereo(InputIterator left, InputIterator right, OutputIterator dst_left,
+        OutputIterator dst_right)
+{
+    execute_stereo(left, right, dst_left, dst_right, stereo_path{});
+}
+
+template <std::size_t N, class real_t>
+template <class InputIterator, class OutputIterator>
+void fft_plan<N, real_t>::execute_stereo(InputIterator left, InputIterator right, OutputIterator dst_left,
+        OutputIterator dst_right, std::true_type)
+{
+    constexpr static auto lut_shuffle  = io_shuffle_table<N>();
+    constexpr static auto lut_window   = hanning_window_table<N, real_t>();
+    constexpr static auto lut_stage_re = fft_stage_root_table_re<N, real_t>();
+    constexpr static auto lut_stage_im = fft_stage_root_table_im<N, real_t>();
+
+    constexpr static auto scale = static_cast<real_t>(1.0 / math::cxpr::sqrt(static_cast<real_t>(N)));
+
+    auto const buffer_re = stereo_re_.data();
+    auto const buffer_im = stereo_im_.data();
+
+    if (stereo_stockham) {
+        fft::pack_stereo_split(left, right, lut_window.data(), buffer_re, buffer_im, N);
+        fft::kernels<real_t>::stockham()(buffer_re, buffer_im, stereo_tmp_re_.data(), stereo_tmp_im_.data(),
+                lut_stage_re.data() + N / 2 - 1, lut_stage_im.data() + N / 2 - 1, N);
+    } else {
+        fft::pack_stereo_shuffled(left, right, lut_window.data(), lut_shuffle.data(), buffer_re, buffer_im, N);
+        fft::kernels<real_t>::radix2()(buffer_re, buffer_im, lut_stage_re.data(), lut_stage_im.data(), N);
+    }
+
+    auto const z = [&](std::size_t k) { return std::complex<real_t>{buffer_re[k], buffer_im[k]}; };
+    fft::unpack_stereo_magnitude(z, N, scale, mode_, buffer_norm_.data(), dst_left, dst_right);
+}
+
+template <std::size_t N, class real_t>
+template <class InputIterator, class OutputIterator>
+void fft_plan<N, real_t>::execute_stereo(InputIterator left, InputIterator right, OutputIterator dst_left,
+        OutputIterator dst_right, std::false_type)
+{
+    constexpr static auto lut_window = hanning_window_table<N, real_t>();
+
+    constexpr static auto scale = static_cast<real_t>(1.0 / math::cxpr::sqrt(static_cast<real_t>(N)));
+
+    auto const buffer_in  = stereo_in_.data();
+    auto const buffer_out = stereo_out_.data();
+
+    fft::pack_stereo_complex(left, right, lut_window.data(), buffer_in, N);
+    stereo_generic_.execute(buffer_in, buffer_out);
+
+    auto const z = [&](std::size_t k) { return buffer_out[k]; };
+    fft::unpack_stereo_magnitude(z, N, scale, mode_, buffer_norm_.data(), dst_left, dst_right);
+}
+
+template <std::size_t N, class real_t>
+template <class InputIterator, class OutputIterator>
+void fft_plan<N, real_t>::execute_stereo(InputIterator left, InputIterator right, OutputIterator dst_left,
+        OutputIterator dst_right, four_step_path)
+{
+    constexpr static auto scale = static_cast<real_t>(1.0 / math::cxpr::sqrt(static_cast<real_t>(N)));
+
+    auto const buffer_re = stereo_tmp_re_.data();
+    auto const buffer_im = stereo_tmp_im_.data();
+
+    fft::pack_stereo_split(left, right, window_.data(), stereo_re_.data(), stereo_im_.data(), N);
+    stereo_four_step_.execute(stereo_re_.data(), stereo_im_.data(), buffer_re, buffer_im);
+
+    auto const z = [&](std::size_t k) { return std::complex<real_t>{buffer_re[k], buffer_im[k]}; };
+    fft::unpack_stereo_magnitude(z, N, scale, mode_, buffer_norm_.data(), dst_left, dst_right);
+}
+
+template <std::size_t N, class real_t>
+template <class InputIterator, class OutputIterator>
+void fft_plan<N, real_t>::execute_stereo_batch(InputIterator left, InputIterator right, OutputIterator dst_left,
+        OutputIterator dst_right, std::size_t count, std::ptrdiff_t stride, std::size_t hop)
+{
+    for (std::size_t i = 0; i < count; i++) {
+        auto const offset = stride * static_cast<std::ptrdiff_t>(i);
+        execute_stereo(std::next(left, hop * i), std::next(right, hop * i), std::next(dst_left, offset),
+                std::next(dst_right, offset));
+    }
+}
+
+template <std::size_t N, class real_t>
+template <class InputIterator, class OutputIterator>
+void fft_plan<N, real_t>::execute_multichannel_batch(InputIterator const* src, OutputIterator const* dst,
+        std::size_t channels, std::size_t count, std::ptrdiff_t stride, std::size_t hop)
+{
+    // all channels of one row are transformed before the next row, keeping the tables in cache
+    for (std::size_t i = 0; i < count; i++) {
+        auto const offset = stride * static_cast<std::ptrdiff_t>(i);
+
+        std::size_t c = 0;
+        for (; c + 1 < channels; c += 2) {
+            execute_stereo(std::next(src[c], hop * i), std::next(src[c + 1], hop * i), std::next(dst[c], offset),
+                    std::next(dst[c + 1], offset));
+        }
+
+        if (c < channels)
+            execute(std::next(src[c], hop * i), std::next(dst[c], offset));
+    }
+}
+
+
+// Runtime-sized equivalent of fft_plan: the tables are generated on construction and shared between copies of
+// the plan, each copy owns its own scratch buffers.
+template <class real_t = float>
+class dynamic_fft_plan {
+public:
+    dynamic_fft_plan()
+            : size_{0}
+            , tables_{}
+            , buffer_re_{}
+            , buffer_im_{}
+            , buffer_tmp_re_{}
+            , buffer_tmp_im_{}
+            , generic_{}
+            , buffer_in_{}
+            , buffer_out_{}
+            , stereo_re_{}
+            , stereo_im_{}
+            , stereo_tmp_re_{}
+            , stereo_tmp_im_{}
+            , stereo_generic_{}
+            , stereo_in_{}
+            , stereo_out_{}
+            , mode_{magnitude_mode::magnitude}
+            , buffer_norm_{} {}
+
+    explicit inline dynamic_fft_plan(std::size_t n);
+
+    inline auto size()        const noexcept -> std::size_t;
+    inline auto output_size() const noexcept -> std::size_t;
+
+    inline auto get_magnitude_mode() const noexcept -> magnitude_mode;
+    inline void set_magnitude_mode(magnitude_mode mode) noexcept;
+
+    template <class InputIterator, class OutputIterator>
+    void execute(InputIterator src, OutputIterator dst);
+
+    // transform without taking the norm: writes the n/2 + 1 complex bins, in the same scale as the magnitudes
+    template <class InputIterator>
+    void execute_spectrum(InputIterator src, std::complex<real_t>* dst);
+
+    template <class InputIterator, class OutputIterator>
+    void execute_batch(InputIterator src, OutputIterator dst, std::size_t count, std::ptrdiff_t stride);
+
+    template <class InputIterator, class OutputIterator>
+    void execute_batch(InputIterator src, OutputIterator dst, std::size_t count, std::ptrdiff_t stride,
+            std::size_t hop);
+
+    template <class InputIterator, class OutputIterator>
+    void execute_stereo(InputIterator left, InputIterator right, OutputIterator dst_left, OutputIterator dst_right);
+
+    template <class InputIterator, class OutputIterator>
+    void execute_stereo_batch(InputIterator left, InputIterator right, OutputIterator dst_left,
+            OutputIterator dst_right, std::size_t count, std::ptrdiff_t stride, std::size_t hop);
+
+    // transform count rows of each of the channels, channels are paired into stereo transforms
+    template <class InputIterator, class OutputIterator>
+    void execute_multichannel_batch(InputIterator const* src, OutputIterator const* dst, std::size_t channels,
+            std::size_t count, std::ptrdiff_t stride, std::size_t hop);
+
+private:
+    struct tables {
+        bool                              radix2;
+        bool                              stockham;
+        bool                              four_step;
+        bool                              stereo_stockham;
+        bool                              stereo_four_step;
+        real_t                            scale;
+        std::vector<std::size_t>          shuffle;
+        std::vector<std::size_t>          stereo_shuffle;
+        std::vector<real_t>               window;
+        std::vector<std::complex<real_t>> roots;
+        std::vector<real_t>               stage_re;
+        std::vector<real_t>               stage_im;
+        fft::four_step_plan<real_t>       four_step_plan;
+        fft::four_step_plan<real_t>       stereo_four_step_plan;
+    };
+
+    static inline auto make_tables(std::size_t n) -> std::shared_ptr<tables const>;
+
+    // transform the windowed input, the result is passed to unpack(z, roots, scale)
+    template <class InputIterator, class Unpack>
+    void transform(InputIterator src, Unpack unpack);
+
+    std::size_t                   size_;
+    std::shared_ptr<tables const> tables_;
+
+    utils::aligned_buffer<real_t>               buffer_re_;
+    utils::aligned_buffer<real_t>               buffer_im_;
+    utils::aligned_buffer<real_t>               buffer_tmp_re_;
+    utils::aligned_buffer<real_t>               buffer_tmp_im_;
+
+    fft::complex_plan<real_t>                   generic_;
+    utils::aligned_buffer<std::complex<real_t>> buffer_in_;
+    utils::aligned_buffer<std::complex<real_t>> buffer_out_;
+
+    utils::aligned_buffer<real_t>               stereo_re_;
+    utils::aligned_buffer<real_t>               stereo_im_;
+    utils::aligned_buffer<real_t>               stereo_tmp_re_;
+    utils::aligned_buffer<real_t>               stereo_tmp_im_;
+    fft::complex_plan<real_t>                   stereo_generic_;
+    utils::aligned_buffer<std::complex<real_t>> stereo_in_;
+    utils::aligned_buffer<std::complex<real_t>> stereo_out_;
+
+    magnitude_mode                              mode_;
+    utils::aligned_buffer<real_t>               buffer_norm_;
+};
+
+
+template <class real_t>
+dynamic_fft_plan<real_t>::dynamic_fft_plan(std::size_t n)
+        : size_{n}
+        , tables_{make_tables(n)}
+        , buffer_re_{}
+        , buffer_im_{}
+        , buffer_tmp_re_{}
+        , buffer_tmp_im_{}
+        , generic_{}
+        , buffer_in_{}
+        , buffer_out_{}
+        , stereo_re_{}
+        , stereo_im_{}
+        , stereo_tmp_re_{}
+        , stereo_tmp_im_{}
+        , stereo_generic_{}
+        , stereo_in_{}
+        , stereo_out_{}
+        , mode_{magnitude_mode::magnitude}
+        , buffer_norm_{2 * rfft_output_size(n)}
+{
+    auto const m = n % 2 == 0 ? n / 2 : n;
+
+    if (tables_->radix2) {
+        buffer_re_ = utils::aligned_buffer<real_t>{m};
+        buffer_im_ = utils::aligned_buffer<real_t>{m};
+        stereo_re_ = utils::aligned_buffer<real_t>{n};
+        stereo_im_ = utils::aligned_buffer<real_t>{n};
+
+        if (tables_->stockham || tables_->four_step) {
+            buffer_tmp_re_ = utils::aligned_buffer<real_t>{m};
+            buffer_tmp_im_ = utils::aligned_buffer<real_t>{m};
+        }
+
+        if (tables_->stereo_stockham || tables_->stereo_four_step) {
+            stereo_tmp_re_ = utils::aligned_buffer<real_t>{n};
+            stereo_tmp_im_ = utils::aligned_buffer<real_t>{n};
+        }
+    } else {
+        generic_    = fft::complex_plan<real_t>{m};
+        buffer_in_  = utils::aligned_buffer<std::complex<real_t>>{m};
+        buffer_out_ = utils::aligned_buffer<std::complex<real_t>>{m};
+
+        stereo_generic_ = fft::complex_plan<real_t>{n};
+        stereo_in_      = utils::aligned_buffer<std::complex<real_t>>{n};
+        stereo_out_     = utils::aligned_buffer<std::complex<real_t>>{n};
+    }
+}
+
+template <class real_t>
+auto dynamic_fft_plan<real_t>::make_tables(std::size_t n) -> std::shared_ptr<tables const> {
+    if (n < 4)
+        throw std::invalid_argument("This FFT implementation requires N to be at least four!");
+
+    auto t = std::make_shared<tables>();
+    auto const m = n % 2 == 0 ? n / 2 : n;
+
+    t->radix2           = bitcount(n) == 1;
+    t->stockham         = t->radix2 && fft::use_stockham(m);
+    t->four_step        = t->radix2 && fft::use_four_step(m);
+    t->stereo_stockham  = t->radix2 && fft::use_stockham(n);
+    t->stereo_four_step = t->radix2 && fft::use_four_step(n);
+    t->scale            = static_cast<real_t>(1.0 / std::sqrt(static_cast<double>(n)));
+
+    t->window.resize(n);
+    for (std::size_t i = 0; i < n; i++)
+        t->window[i] = static_cast<real_t>(0.5 * (1.0 - std::cos((2.0 * math::pi<double> * i) / (n - 1.0))));
+
+    t->roots.resize(n / 2);
+    for (std::size_t k = 0; k < n / 2; k++) {
+        double const arg = 2.0 * math::pi<double> * k / n;
+        t->roots[k] = {static_cast<real_t>(std::cos(arg)), static_cast<real_t>(-std::sin(arg))};
+    }
+
+    if (t->radix2) {
+        auto const make_shuffle = [](std::size_t size) {
+            auto shuffle = std::vector<std::size_t>(size);
+            for (std::size_t i = 0; i < size; i++)
+                shuffle[i] = bitrev(i, bitcount(size - 1) - 1);
 
-    constexpr static auto lut_shuffle = io_shuffle_table<N>();
-    constexpr static auto lut_window  = hanning_window_table<N, real_t>();
-    constexpr static auto lut_roots   = fft_root_table<N, real_t>();
+            return shuffle;
+        };
 
-    constexpr static auto scale = 1.0 / math::cxpr::sqrt(static_cast<real_t>(N));
+        if (!t->stockham && !t->four_step)
+            t->shuffle = make_shuffle(m);
 
-    // convert real-data to complex data and shuffle
-    auto buffer = std::array<std::complex<real_t>, N>();
-    for (std::size_t i = 0; i < N; i++)
-        buffer[lut_shuffle[i]] = {*(src++) * lut_window[i]};
+        if (!t->stereo_stockham && !t->stereo_four_step)
+            t->stereo_shuffle = make_shuffle(n);
 
-    // perform fft
-    for (std::uint64_t groups = N/2; groups > 0; groups >>=1) {
-        auto values = N / groups;
-        auto pairs = values / 2;
+        if (t->four_step)
+            t->four_step_plan = fft::four_step_plan<real_t>{m};
 
-        for (std::uint64_t group = 0; group < groups; group++) {
-            auto index_a = group * values;
-            auto index_b = index_a + pairs;
+        if (t->stereo_four_step)
+            t->stereo_four_step_plan = fft::four_step_plan<real_t>{n};
 
-            for (std::uint64_t pair = 0; pair < pairs; pair++, index_a++, index_b++) {
-                auto tmp = buffer[index_b] * lut_roots[pair * groups];
-                buffer[index_b] = buffer[index_a] - tmp;
-                buffer[index_a] = buffer[index_a] + tmp;
-            }
+        // stage roots up to the largest size not using the four-step transform (the four-step plans have their own
+        // tables), the first m - 1 entries are those of size m
+        auto const stages = t->stereo_four_step ? (t->four_step ? 1 : m) : n;
+
+        t->stage_re.resize(stages - 1);
+        t->stage_im.resize(stages - 1);
+        for (std::size_t i = 0; i < stages - 1; i++) {
+            double const arg = fft_stage_root_table_arg<double>(i);
+            t->stage_re[i] = static_cast<real_t>(std::cos(arg));
+            t->stage_im[i] = static_cast<real_t>(-std::sin(arg));
         }
     }
 
-    // calculate magnitude
-    for (std::size_t i = 0; i < N; i++)
-        *(dst++) = std::abs(buffer[i]) * scale;
+    return t;
+}
+
+template <class real_t>
+auto dynamic_fft_plan<real_t>::size() const noexcept -> std::size_t {
+    return size_;
+}
+
+template <class real_t>
+auto dynamic_fft_plan<real_t>::output_size() const noexcept -> std::size_t {
+    return rfft_output_size(size_);
+}
+
+template <class real_t>
+auto dynamic_fft_plan<real_t>::get_magnitude_mode() const noexcept -> magnitude_mode {
+    return mode_;
+}
+
+template <class real_t>
+void dynamic_fft_plan<real_t>::set_magnitude_mode(magnitude_mode mode) noexcept {
+    mode_ = mode;
+}
+
+template <class real_t>
+template <class InputIterator, class OutputIterator>
+void dynamic_fft_plan<real_t>::execute(InputIterator src, OutputIterator dst) {
+    transform(src, [&](auto z, std::complex<real_t> const* roots, real_t scale) {
+        fft::unpack_magnitude(z, roots, size_, scale, mode_, buffer_norm_.data(), dst);
+    });
+}
+
+template <class real_t>
+template <class InputIterator>
+void dynamic_fft_plan<real_t>::execute_spectrum(InputIterator src, std::complex<real_t>* dst) {
+    transform(src, [&](auto z, std::complex<real_t> const* roots, real_t scale) {
+        fft::unpack_norm(z, roots, size_, fft::norm_complex<real_t>{scale}, dst);
+    });
+}
+
+template <class real_t>
+template <class InputIterator, class Unpack>
+void dynamic_fft_plan<real_t>::transform(InputIterator src, Unpack unpack) {
+    auto const& t = *tables_;
+
+    if (t.radix2) {
+        auto const buffer_re = buffer_re_.data();
+        auto const buffer_im = buffer_im_.data();
+
+        auto const m = size_ / 2;
+
+        // result of the complex transform, the four-step transform is out-of-place
+        auto out_re = buffer_re;
+        auto out_im = buffer_im;
+
+        if (t.four_step) {
+            out_re = buffer_tmp_re_.data();
+            out_im = buffer_tmp_im_.data();
+
+            fft::pack_split(src, t.window.data(), buffer_re, buffer_im, size_);
+            t.four_step_plan.execute(buffer_re, buffer_im, out_re, out_im);
+        } else if (t.stockham) {
+            fft::pack_split(src, t.window.data(), buffer_re, buffer_im, size_);
+            fft::kernels<real_t>::stockham()(buffer_re, buffer_im, buffer_tmp_re_.data(), buffer_tmp_im_.data(),
+                    t.stage_re.data() + m / 2 - 1, t.stage_im.data() + m / 2 - 1, m);
+        } else {
+            fft::pack_shuffled(src, t.window.data(), t.shuffle.data(), buffer_re, buffer_im, size_);
+            fft::kernels<real_t>::radix2()(buffer_re, buffer_im, t.stage_re.data(), t.stage_im.data(), m);
+        }
+
+        auto const z = [&](std::size_t k) { return std::complex<real_t>{out_re[k], out_im[k]}; };
+        unpack(z, t.roots.data(), t.scale);
+
+    } else {
+        auto const buffer_in  = buffer_in_.data();
+        auto const buffer_out = buffer_out_.data();
+
+        fft::pack_complex(src, t.window.data(), buffer_in, size_);
+        generic_.execute(buffer_in, buffer_out);
+
+        auto const z = [&](std::size_t k) { return buffer_out[k]; };
+        unpack(z, t.roots.data(), t.scale);
+    }
+}
+
+template <class real_t>
+template <class InputIterator, class OutputIterator>
+void dynamic_fft_plan<real_t>::execute_batch(InputIterator src, OutputIterator dst, std::size_t count,
+        std::ptrdiff_t stride)
+{
+    execute_batch(src, dst, count, stride, size_);
+}
+
+template <class real_t>
+template <class InputIterator, class OutputIterator>
+void dynamic_fft_plan<real_t>::execute_batch(InputIterator src, OutputIterator dst, std::size_t count,
+        std::ptrdiff_t stride, std::size_t hop)
+{
+    // chunks of size() samples start every hop samples in src, output rows start every stride elements in dst
+    for (std::size_t i = 0; i < count; i++)
+        execute(std::next(src, hop * i), std::next(dst, stride * static_cast<std::ptrdiff_t>(i)));
+}
+
+template <class real_t>
+template <class InputIterator, class OutputIterator>
+void dynamic_fft_plan<real_t>::execute_stereo(InputIterator left, InputIterator right, OutputIterator dst_left,
+        OutputIterator dst_right)
+{
+    auto const& t = *tables_;
+
+    if (t.radix2) {
+        auto const buffer_re = stereo_re_.data();
+        auto const buffer_im = stereo_im_.data();
+
+        auto const n = size_;
+
+        auto out_re = buffer_re;
+        auto out_im = buffer_im;
+
+        if (t.stereo_four_step) {
+            out_re = stereo_tmp_re_.data();
+            out_im = stereo_tmp_im_.data();
+
+            fft::pack_stereo_split(left, right, t.window.data(), buffer_re, buffer_im, n);
+            t.stereo_four_step_plan.execute(buffer_re, buffer_im, out_re, out_im);
+        } else if (t.stereo_stockham) {
+            fft::pack_stereo_split(left, right, t.window.data(), buffer_re, buffer_im, n);
+            fft::kernels<real_t>::stockham()(buffer_re, buffer_im, stereo_tmp_re_.data(), stereo_tmp_im_.data(),
+                    t.stage_re.data() + n / 2 - 1, t.stage_im.data() + n / 2 - 1, n);
+        } else {
+            fft::pack_stereo_shuffled(left, right, t.window.data(), t.stereo_shuffle.data(), buffer_re, buffer_im, n);
+            fft::kernels<real_t>::radix2()(buffer_re, buffer_im, t.stage_re.data(), t.stage_im.data(), n);
+        }
+
+        auto const z = [&](std::size_t k) { return std::complex<real_t>{out_re[k], out_im[k]}; };
+        fft::unpack_stereo_magnitude(z, n, t.scale, mode_, buffer_norm_.data(), dst_left, dst_right);
+
+    } else {
+        auto const buffer_in  = stereo_in_.data();
+        auto const buffer_out = stereo_out_.data();
+
+        fft::pack_stereo_complex(left, right, t.window.data(), buffer_in, size_);
+        stereo_generic_.execute(buffer_in, buffer_out);
+
+        auto const z = [&](std::size_t k) { return buffer_out[k]; };
+        fft::unpack_stereo_magnitude(z, size_, t.scale, mode_, buffer_norm_.data(), dst_left, dst_right);
+    }
+}
+
+template <class real_t>
+template <class InputIterator, class OutputIterator>
+void dynamic_fft_plan<real_t>::execute_stereo_batch(InputIterator left, InputIterator right,
+        OutputIterator dst_left, OutputIterator dst_right, std::size_t count, std::ptrdiff_t stride, std::size_t hop)
+{
+    for (std::size_t i = 0; i < count; i++) {
+        auto const offset = stride * static_cast<std::ptrdiff_t>(i);
+        execute_stereo(std::next(left, hop * i), std::next(right, hop * i), std::next(dst_left, offset),
+                std::next(dst_right, offset));
+    }
+}
+
+template <class real_t>
+template <class InputIterator, class OutputIterator>
+void dynamic_fft_plan<real_t>::execute_multichannel_batch(InputIterator const* src, OutputIterator const* dst,
+        std::size_t channels, std::size_t count, std::ptrdiff_t stride, std::size_t hop)
+{
+    // all channels of one row are transformed before the next row, keeping the tables in cache
+    for (std::size_t i = 0; i < count; i++) {
+        auto const offset = stride * static_cast<std::ptrdiff_t>(i);
+
+        std::size_t c = 0;
+        for (; c + 1 < channels; c += 2) {
+            execute_stereo(std::next(src[c], hop * i), std::next(src[c + 1], hop * i), std::next(dst[c], offset),
+                    std::next(dst[c + 1], offset));
+        }
+
+        if (c < channels)
+            execute(std::next(src[c], hop * i), std::next(dst[c], offset));
+    }
+}
+
+
+template<std::size_t N, class InputIterator, class OutputIterator, class real_t = typename std::iterator_traits<InputIterator>::value_type>
+void rfft(InputIterator src, OutputIterator dst) {
+    fft_plan<N, real_t>{}.execute(src, dst);
 }
 
 
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <avis/audio/fft/mixed_radix.hpp>
+#include <avis/utils/aligned_buffer.hpp>
+
+#include <cinttypes>
+#include <cmath>
+#include <complex>
+
+
+namespace avis {
+namespace audio {
+namespace fft {
+
+// Forward complex FFT of arbitrary size using Bluestein's algorithm: the DFT is expressed as a convolution with a
+// chirp, which is evaluated using power-of-two FFTs of size m >= 2n - 1.
+template <class real_t>
+class bluestein_plan {
+public:
+    using complex_type = std::complex<real_t>;
+
+    bluestein_plan()
+            : size_{0}
+            , fft_{}
+            , chirp_{}
+            , kernel_{}
+            , buffer_a_{}
+            , buffer_b_{} {}
+
+    explicit inline bluestein_plan(std::size_t n);
+
+    inline auto size() const noexcept -> std::size_t;
+
+    inline void execute(complex_type const* in, complex_type* out);
+
+private:
+    std::size_t                         size_;
+    mixed_radix_plan<real_t>            fft_;
+    utils::aligned_buffer<complex_type> chirp_;
+    utils::aligned_buffer<complex_type> kernel_;
+    utils::aligned_buffer<complex_type> buffer_a_;
+    utils::aligned_buffer<complex_type> buffer_b_;
+};
+
+
+template <class real_t>
+bluestein_plan<real_t>::bluestein_plan(std::size_t n)
+        : size_{n}
+        , fft_{}
+        , chirp_{n}
+        , kernel_{}
+        , buffer_a_{}
+        , buffer_b_{}
+{
+    std::size_t m = 1;
+    while (m + 1 < 2 * n)
+        m *= 2;
+
+    fft_      = mixed_radix_plan<real_t>{m};
+    kernel_   = utils::aligned_buffer<complex_type>{m};
+    buffer_a_ = utils::aligned_buffer<complex_type>{m};
+    buffer_b_ = utils::aligned_buffer<complex_type>{m};
+
+    // chirp w[k] = exp(-i pi k^2 / n), reduce k^2 modulo 2n to keep the argument small
+    for (std::size_t k = 0; k < n; k++) {
+        auto const k2 = (static_cast<std::uint64_t>(k) * k) % (2 * n);
+        double const arg = -math::pi<double> * k2 / n;
+        chirp_[k] = {static_cast<real_t>(std::cos(arg)), static_cast<real_t>(std::sin(arg))};
+    }
+
+    // convolution kernel conj(w[k]) for -n < k < n in wrap-around order, transformed and scaled by 1/m
+    buffer_a_[0] = std::conj(chirp_[0]);
+    for (std::size_t k = 1; k < n; k++)
+        buffer_a_[k] = buffer_a_[m - k] = std::conj(chirp_[k]);
+
+    fft_.execute(buffer_a_.data(), kernel_.data());
+
+    for (auto& v : kernel_)
+        v /= static_cast<real_t>(m);
+}
+
+template <class real_t>
+auto bluestein_plan<real_t>::size() const noexcept -> std::size_t {
+    return size_;
+}
+
+template <class real_t>
+void bluestein_plan<real_t>::execute(complex_type const* in, complex_type* out) {
+    auto const m = fft_.size();
+
+    // multiply with chirp and zero-pad
+    for (std::size_t k = 0; k < size_; k++)
+        buffer_a_[k] = cmul(in[k], chirp_[k]);
+
+    std::fill(buffer_a_.begin() + size_, buffer_a_.end(), complex_type{});
+
+    // convolve with kernel, inverse transform via ifft(x) = conj(fft(conj(x)))
+    fft_.execute(buffer_a_.data(), buffer_b_.data());
+
+    for (std::size_t k = 0; k < m; k++)
+        buffer_b_[k] = std::conj(cmul(buffer_b_[k], kernel_[k]));
+
+    fft_.execute(buffer_b_.data(), buffer_a_.data());
+
+    // multiply with chirp
+    for (std::size_t k = 0; k < size_; k++)
+        out[k] = cmul(std::conj(buffer_a_[k]), chirp_[k]);
+}
+
+} /* namespace fft */
+} /* namespace audio */
+} /* namespace avis */
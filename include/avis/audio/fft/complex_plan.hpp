@@ -0,0 +1,68 @@
+#pragma once
+
+#include <avis/audio/fft/mixed_radix.hpp>
+#include <avis/audio/fft/bluestein.hpp>
+
+#include <complex>
+
+
+namespace avis {
+namespace audio {
+namespace fft {
+
+// Forward complex FFT of arbitrary size: sizes with prime factors 2, 3 and 5 are transformed directly using the
+// mixed-radix kernels, all other sizes (i.e. sizes with larger prime factors) fall back to Bluestein's algorithm.
+template <class real_t>
+class complex_plan {
+public:
+    using complex_type = std::complex<real_t>;
+
+    complex_plan()
+            : size_{0}
+            , direct_{}
+            , bluestein_{} {}
+
+    explicit complex_plan(std::size_t n)
+            : size_{n}
+            , direct_{}
+            , bluestein_{}
+    {
+        if (mixed_radix_plan<real_t>::supports(n))
+            direct_ = mixed_radix_plan<real_t>{n};
+        else
+            bluestein_ = bluestein_plan<real_t>{n};
+    }
+
+    inline auto size() const noexcept -> std::size_t;
+    inline auto uses_bluestein() const noexcept -> bool;
+
+    inline void execute(complex_type const* in, complex_type* out);
+
+private:
+    std::size_t              size_;
+    mixed_radix_plan<real_t> direct_;
+    bluestein_plan<real_t>   bluestein_;
+};
+
+
+template <class real_t>
+auto complex_plan<real_t>::size() const noexcept -> std::size_t {
+    return size_;
+}
+
+template <class real_t>
+auto complex_plan<real_t>::uses_bluestein() const noexcept -> bool {
+    return bluestein_.size() != 0;
+}
+
+template <class real_t>
+void complex_plan<real_t>::execute(complex_type const* in, complex_type* out) {
+    if (uses_bluestein())
+        bluestein_.execute(in, out);
+    else
+        direct_.execute(in, out);
+}
+
+} /* namespace fft */
+} /* namespace audio */
+} /* namespace avis */
@@ -0,0 +1,463 @@
+#pragma once
+
+#include <avis/audio/fft/kernels.hpp>
+#include <avis/utils/constexpr_math.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+
+namespace avis {
+namespace audio {
+namespace fft {
+
+// Complex power-of-two sizes beyond the Stockham range, i.e. real transforms of 2^16 points and more, are
+// decomposed into cache-sized sub-transforms: each of the log2(n) stages of the single-buffer kernels streams the
+// whole working set (data, scratch buffer and tables) through the cache, and their first stages are scalar. Measured
+// with AVX-512 and 2 MB L2, the decomposition is about 1.7 times faster than the Stockham kernels from 2^15 up to
+// 2^20 complex points.
+constexpr auto use_four_step(std::size_t n) noexcept -> bool {
+    return n > stockham_max_size;
+}
+
+
+namespace four_step_kernels {
+
+// Radix-2 FFTs along the columns of a block of n rows of width elements, the rows in bit-reversed order: each
+// column holds one transform, so every butterfly combines two whole rows with a single twiddle and all stages are
+// vectorized. The stage roots are stored as for the radix-2 kernels.
+constexpr std::size_t width = 64;
+
+template <class real_t>
+using columns_fn = void (*)(real_t* re, real_t* im, real_t const* w_re, real_t const* w_im, std::size_t n);
+
+// Multiply width elements by the twiddles s v[j], j < width.
+template <class real_t>
+using twiddle_fn = void (*)(real_t* re, real_t* im, real_t const* v_re, real_t const* v_im, real_t s_re, real_t s_im);
+
+template <class real_t>
+inline void columns_scalar(real_t* re, real_t* im, real_t const* w_re, real_t const* w_im, std::size_t n) {
+    for (std::size_t h = 1; h < n; h *= 2) {
+        for (std::size_t group = 0; group < n; group += 2 * h) {
+            for (std::size_t j = 0; j < h; j++) {
+                auto const wr = w_re[h - 1 + j];
+                auto const wi = w_im[h - 1 + j];
+                auto const a  = (group + j) * width;
+                auto const b  = a + h * width;
+
+                for (std::size_t c = 0; c < width; c++) {
+                    auto const t_re = re[b + c] * wr - im[b + c] * wi;
+                    auto const t_im = re[b + c] * wi + im[b + c] * wr;
+
+                    re[b + c] = re[a + c] - t_re;
+                    im[b + c] = im[a + c] - t_im;
+                    re[a + c] = re[a + c] + t_re;
+                    im[a + c] = im[a + c] + t_im;
+                }
+            }
+        }
+    }
+}
+
+template <class real_t>
+inline void twiddle_scalar(real_t* re, real_t* im, real_t const* v_re, real_t const* v_im, real_t s_re, real_t s_im) {
+    for (std::size_t j = 0; j < width; j++) {
+        auto const w_re = s_re * v_re[j] - s_im * v_im[j];
+        auto const w_im = s_re * v_im[j] + s_im * v_re[j];
+
+        auto const r = re[j] * w_re - im[j] * w_im;
+        auto const c = re[j] * w_im + im[j] * w_re;
+        re[j] = r;
+        im[j] = c;
+    }
+}
+
+
+#ifdef AVIS_AUDIO_FFT_X86_KERNELS
+
+__attribute__((target("avx2,fma")))
+inline void columns_avx2(float* re, float* im, float const* w_re, float const* w_im, std::size_t n) {
+    for (std::size_t h = 1; h < n; h *= 2) {
+        for (std::size_t group = 0; group < n; group += 2 * h) {
+            for (std::size_t j = 0; j < h; j++) {
+                auto const wr = _mm256_set1_ps(w_re[h - 1 + j]);
+                auto const wi = _mm256_set1_ps(w_im[h - 1 + j]);
+                auto const a  = (group + j) * width;
+                auto const b  = a + h * width;
+
+                for (std::size_t c = 0; c < width; c += 8) {
+                    auto const ar = _mm256_loadu_ps(re + a + c);
+                    auto const ai = _mm256_loadu_ps(im + a + c);
+                    auto const br = _mm256_loadu_ps(re + b + c);
+                    auto const bi = _mm256_loadu_ps(im + b + c);
+
+                    auto const tr = _mm256_fmsub_ps(br, wr, _mm256_mul_ps(bi, wi));
+                    auto const ti = _mm256_fmadd_ps(br, wi, _mm256_mul_ps(bi, wr));
+
+                    _mm256_storeu_ps(re + b + c, _mm256_sub_ps(ar, tr));
+                    _mm256_storeu_ps(im + b + c, _mm256_sub_ps(ai, ti));
+                    _mm256_storeu_ps(re + a + c, _mm256_add_ps(ar, tr));
+                    _mm256_storeu_ps(im + a + c, _mm256_add_ps(ai, ti));
+                }
+            }
+        }
+    }
+}
+
+__attribute__((target("avx2,fma")))
+inline void twiddle_avx2(float* re, float* im, float const* v_re, float const* v_im, float s_re, float s_im) {
+    auto const sr = _mm256_set1_ps(s_re);
+    auto const si = _mm256_set1_ps(s_im);
+
+    for (std::size_t j = 0; j < width; j += 8) {
+        auto const vr = _mm256_loadu_ps(v_re + j);
+        auto const vi = _mm256_loadu_ps(v_im + j);
+        auto const xr = _mm256_loadu_ps(re + j);
+        auto const xi = _mm256_loadu_ps(im + j);
+
+        auto const wr = _mm256_fmsub_ps(sr, vr, _mm256_mul_ps(si, vi));
+        auto const wi = _mm256_fmadd_ps(sr, vi, _mm256_mul_ps(si, vr));
+
+        _mm256_storeu_ps(re + j, _mm256_fmsub_ps(xr, wr, _mm256_mul_ps(xi, wi)));
+        _mm256_storeu_ps(im + j, _mm256_fmadd_ps(xr, wi, _mm256_mul_ps(xi, wr)));
+    }
+}
+
+__attribute__((target("avx512f")))
+inline void columns_avx512(float* re, float* im, float const* w_re, float const* w_im, std::size_t n) {
+    for (std::size_t h = 1; h < n; h *= 2) {
+        for (std::size_t group = 0; group < n; group += 2 * h) {
+            for (std::size_t j = 0; j < h; j++) {
+                auto const wr = _mm512_set1_ps(w_re[h - 1 + j]);
+                auto const wi = _mm512_set1_ps(w_im[h - 1 + j]);
+                auto const a  = (group + j) * width;
+                auto const b  = a + h * width;
+
+                for (std::size_t c = 0; c < width; c += 16) {
+                    auto const ar = _mm512_loadu_ps(re + a + c);
+                    auto const ai = _mm512_loadu_ps(im + a + c);
+                    auto const br = _mm512_loadu_ps(re + b + c);
+                    auto const bi = _mm512_loadu_ps(im + b + c);
+
+                    auto const tr = _mm512_fmsub_ps(br, wr, _mm512_mul_ps(bi, wi));
+                    auto const ti = _mm512_fmadd_ps(br, wi, _mm512_mul_ps(bi, wr));
+
+                    _mm512_storeu_ps(re + b + c, _mm512_sub_ps(ar, tr));
+                    _mm512_storeu_ps(im + b + c, _mm512_sub_ps(ai, ti));
+                    _mm512_storeu_ps(re + a + c, _mm512_add_ps(ar, tr));
+                    _mm512_storeu_ps(im + a + c, _mm512_add_ps(ai, ti));
+                }
+            }
+        }
+    }
+}
+
+__attribute__((target("avx512f")))
+inline void twiddle_avx512(float* re, float* im, float const* v_re, float const* v_im, float s_re, float s_im) {
+    auto const sr = _mm512_set1_ps(s_re);
+    auto const si = _mm512_set1_ps(s_im);
+
+    for (std::size_t j = 0; j < width; j += 16) {
+        auto const vr = _mm512_loadu_ps(v_re + j);
+        auto const vi = _mm512_loadu_ps(v_im + j);
+        auto const xr = _mm512_loadu_ps(re + j);
+        auto const xi = _mm512_loadu_ps(im + j);
+
+        auto const wr = _mm512_fmsub_ps(sr, vr, _mm512_mul_ps(si, vi));
+        auto const wi = _mm512_fmadd_ps(sr, vi, _mm512_mul_ps(si, vr));
+
+        _mm512_storeu_ps(re + j, _mm512_fmsub_ps(xr, wr, _mm512_mul_ps(xi, wi)));
+        _mm512_storeu_ps(im + j, _mm512_fmadd_ps(xr, wi, _mm512_mul_ps(xi, wr)));
+    }
+}
+
+#endif /* AVIS_AUDIO_FFT_X86_KERNELS */
+
+template <class real_t>
+inline auto select_columns() noexcept -> columns_fn<real_t> {
+    return columns_scalar<real_t>;
+}
+
+template <>
+inline auto select_columns<float>() noexcept -> columns_fn<float> {
+    switch (get_kernel_isa()) {
+#ifdef AVIS_AUDIO_FFT_X86_KERNELS
+    case kernel_isa::avx512:    return columns_avx512;
+    case kernel_isa::avx2:      return columns_avx2;
+#endif
+    default:                    return columns_scalar<float>;
+    }
+}
+
+template <class real_t>
+inline auto select_twiddle() noexcept -> twiddle_fn<real_t> {
+    return twiddle_scalar<real_t>;
+}
+
+template <>
+inline auto select_twiddle<float>() noexcept -> twiddle_fn<float> {
+    switch (get_kernel_isa()) {
+#ifdef AVIS_AUDIO_FFT_X86_KERNELS
+    case kernel_isa::avx512:    return twiddle_avx512;
+    case kernel_isa::avx2:      return twiddle_avx2;
+#endif
+    default:                    return twiddle_scalar<float>;
+    }
+}
+
+} /* namespace four_step_kernels */
+
+
+// Forward complex FFT of power-of-two size n = n1 * n2 on split (SoA) data, using the four-step decomposition: the
+// input, viewed as n1 x n2 matrix, is transformed along its columns (length n1), multiplied by the twiddles
+// W_n^(i k) and transposed, and the result is transformed along its columns again (length n2), which yields the
+// natural order. The columns are transformed in blocks of a few columns that fit into L2 (gathered in bit-reversed
+// row order), the transpose is cache-blocked, and the twiddles are factored into two tables of n1 and n2 entries,
+// W_n^e = W_n^(n1 (e / n1)) * W_n^(e % n1), so that only about sqrt(n) table entries are used.
+template <class real_t>
+class four_step_plan {
+public:
+    four_step_plan()
+            : size_{0}
+            , n1_{0}
+            , n2_{0}
+            , log2_n1_{0}
+            , shuffle1_{}
+            , shuffle2_{}
+            , stage_re_{}
+            , stage_im_{}
+            , twiddle_lo_re_{}
+            , twiddle_lo_im_{}
+            , twiddle_hi_re_{}
+            , twiddle_hi_im_{} {}
+
+    explicit inline four_step_plan(std::size_t n);
+
+    inline auto size() const noexcept -> std::size_t;
+
+    // transform re/im into out_re/out_im, re/im are used as scratch buffer
+    inline void execute(real_t* re, real_t* im, real_t* out_re, real_t* out_im) const;
+
+private:
+    static constexpr std::size_t width = four_step_kernels::width;
+    static constexpr std::size_t block = 32;
+
+    static inline auto make_shuffle(std::size_t n) -> std::vector<std::size_t>;
+
+    // transform the columns of the rows x cols matrix re/im in place, the first rows * width elements of tmp_re and
+    // tmp_im are used as scratch
+    inline void columns(real_t* re, real_t* im, real_t* tmp_re, real_t* tmp_im, std::size_t rows, std::size_t cols,
+            std::size_t const* shuffle) const;
+
+    // dst[c * n1 + r] = src[r * n2 + c] * W_n^(r c), for the n1 x n2 matrix src
+    inline void transpose(real_t const* src_re, real_t const* src_im, real_t* dst_re, real_t* dst_im) const;
+
+    // multiply row k of the transposed matrix by the twiddles W_n^(i k), i < n1
+    inline void twiddle(real_t* re, real_t* im, std::size_t k) const noexcept;
+
+    std::size_t              size_;
+    std::size_t              n1_;
+    std::size_t              n2_;
+    std::size_t              log2_n1_;
+    std::vector<std::size_t> shuffle1_;
+    std::vector<std::size_t> shuffle2_;
+    std::vector<real_t>      stage_re_;         // stage roots up to n2, the first n1 - 1 entries are those of n1
+    std::vector<real_t>      stage_im_;
+    std::vector<real_t>      twiddle_lo_re_;    // W_n^j for j < n1
+    std::vector<real_t>      twiddle_lo_im_;
+    std::vector<real_t>      twiddle_hi_re_;    // W_n^(n1 j) for j < n2
+    std::vector<real_t>      twiddle_hi_im_;
+};
+
+
+template <class real_t>
+constexpr std::size_t four_step_plan<real_t>::width;
+
+template <class real_t>
+constexpr std::size_t four_step_plan<real_t>::block;
+
+template <class real_t>
+four_step_plan<real_t>::four_step_plan(std::size_t n)
+        : size_{n}
+        , n1_{0}
+        , n2_{0}
+        , log2_n1_{0}
+        , shuffle1_{}
+        , shuffle2_{}
+        , stage_re_{}
+        , stage_im_{}
+        , twiddle_lo_re_{}
+        , twiddle_lo_im_{}
+        , twiddle_hi_re_{}
+        , twiddle_hi_im_{}
+{
+    std::size_t log2n = 0;
+    while ((std::size_t{1} << log2n) < n)
+        log2n++;
+
+    // both dimensions are transformed in blocks of width columns
+    if ((std::size_t{1} << log2n) != n || n < width * width)
+        throw std::invalid_argument("The four-step FFT requires N to be a power of two and at least 4096!");
+
+    log2_n1_ = log2n / 2;
+    n1_ = std::size_t{1} << log2_n1_;
+    n2_ = n / n1_;
+
+    shuffle1_ = make_shuffle(n1_);
+    shuffle2_ = make_shuffle(n2_);
+
+    // stage roots: W_{2h}^j for the stage with h butterfly-pairs start at h - 1
+    stage_re_.resize(n2_ - 1);
+    stage_im_.resize(n2_ - 1);
+    for (std::size_t h = 1; h < n2_; h *= 2) {
+        for (std::size_t j = 0; j < h; j++) {
+            double const arg = -math::pi<double> * j / h;
+            stage_re_[h - 1 + j] = static_cast<real_t>(std::cos(arg));
+            stage_im_[h - 1 + j] = static_cast<real_t>(std::sin(arg));
+        }
+    }
+
+    twiddle_lo_re_.resize(n1_);
+    twiddle_lo_im_.resize(n1_);
+    for (std::size_t j = 0; j < n1_; j++) {
+        double const arg = -2.0 * math::pi<double> * j / n;
+        twiddle_lo_re_[j] = static_cast<real_t>(std::cos(arg));
+        twiddle_lo_im_[j] = static_cast<real_t>(std::sin(arg));
+    }
+
+    twiddle_hi_re_.resize(n2_);
+    twiddle_hi_im_.resize(n2_);
+    for (std::size_t j = 0; j < n2_; j++) {
+        double const arg = -2.0 * math::pi<double> * j / n2_;
+        twiddle_hi_re_[j] = static_cast<real_t>(std::cos(arg));
+        twiddle_hi_im_[j] = static_cast<real_t>(std::sin(arg));
+    }
+}
+
+template <class real_t>
+auto four_step_plan<real_t>::make_shuffle(std::size_t n) -> std::vector<std::size_t> {
+    std::size_t bits = 0;
+    while ((std::size_t{1} << bits) < n)
+        bits++;
+
+    auto shuffle = std::vector<std::size_t>(n);
+    for (std::size_t i = 0; i < n; i++) {
+        std::size_t rev = 0;
+        for (std::size_t b = 0; b < bits; b++)
+            rev |= ((i >> b) & 1) << (bits - 1 - b);
+
+        shuffle[i] = rev;
+    }
+
+    return shuffle;
+}
+
+template <class real_t>
+auto four_step_plan<real_t>::size() const noexcept -> std::size_t {
+    return size_;
+}
+
+template <class real_t>
+void four_step_plan<real_t>::columns(real_t* re, real_t* im, real_t* tmp_re, real_t* tmp_im, std::size_t rows,
+        std::size_t cols, std::size_t const* shuffle) const
+{
+    static auto const fn = four_step_kernels::select_columns<real_t>();
+
+    for (std::size_t c = 0; c < cols; c += width) {
+        for (std::size_t r = 0; r < rows; r++) {
+            auto const src = shuffle[r] * cols + c;
+            std::copy(re + src, re + src + width, tmp_re + r * width);
+            std::copy(im + src, im + src + width, tmp_im + r * width);
+        }
+
+        fn(tmp_re, tmp_im, stage_re_.data(), stage_im_.data(), rows);
+
+        for (std::size_t r = 0; r < rows; r++) {
+            auto const dst = r * cols + c;
+            std::copy(tmp_re + r * width, tmp_re + (r + 1) * width, re + dst);
+            std::copy(tmp_im + r * width, tmp_im + (r + 1) * width, im + dst);
+        }
+    }
+}
+
+template <class real_t>
+void four_step_plan<real_t>::transpose(real_t const* src_re, real_t const* src_im, real_t* dst_re, real_t* dst_im)
+        const
+{
+    // with power-of-two strides all lines of a block map to the same cache set: go through a local tile so that
+    // each destination line is written completely at once
+    real_t tile_re[block][block];
+    real_t tile_im[block][block];
+
+    // one strip of destination rows at a time, twiddled while still in cache
+    for (std::size_t c0 = 0; c0 < n2_; c0 += block) {
+        for (std::size_t r0 = 0; r0 < n1_; r0 += block) {
+            for (std::size_t r = 0; r < block; r++) {
+                auto const offset = (r0 + r) * n2_ + c0;
+
+                for (std::size_t c = 0; c < block; c++) {
+                    tile_re[c][r] = src_re[offset + c];
+                    tile_im[c][r] = src_im[offset + c];
+                }
+            }
+
+            for (std::size_t c = 0; c < block; c++) {
+                auto const offset = (c0 + c) * n1_ + r0;
+
+                std::copy(tile_re[c], tile_re[c] + block, dst_re + offset);
+                std::copy(tile_im[c], tile_im[c] + block, dst_im + offset);
+            }
+        }
+
+        for (std::size_t c = c0; c < c0 + block; c++)
+            twiddle(dst_re + c * n1_, dst_im + c * n1_, c);
+    }
+}
+
+template <class real_t>
+void four_step_plan<real_t>::twiddle(real_t* re, real_t* im, std::size_t k) const noexcept {
+    auto const mask   = n1_ - 1;
+    auto const lookup = [&](std::size_t e, real_t& w_re, real_t& w_im) {
+        auto const hi_re = twiddle_hi_re_[e >> log2_n1_];
+        auto const hi_im = twiddle_hi_im_[e >> log2_n1_];
+        auto const lo_re = twiddle_lo_re_[e & mask];
+        auto const lo_im = twiddle_lo_im_[e & mask];
+
+        w_re = hi_re * lo_re - hi_im * lo_im;
+        w_im = hi_re * lo_im + hi_im * lo_re;
+    };
+
+    static auto const fn = four_step_kernels::select_twiddle<real_t>();
+
+    // W_n^(i k) for i = i0 + j is W_n^(i0 k) W_n^(j k): one lookup per width elements, with i k < n1 n2 no
+    // reduction modulo n is required
+    real_t v_re[width];
+    real_t v_im[width];
+    for (std::size_t j = 0; j < width; j++)
+        lookup(j * k, v_re[j], v_im[j]);
+
+    for (std::size_t i0 = 0; i0 < n1_; i0 += width) {
+        real_t s_re, s_im;
+        lookup(i0 * k, s_re, s_im);
+
+        fn(re + i0, im + i0, v_re, v_im, s_re, s_im);
+    }
+}
+
+template <class real_t>
+void four_step_plan<real_t>::execute(real_t* re, real_t* im, real_t* out_re, real_t* out_im) const {
+    // x[k + n2 i] as n1 x n2 matrix: n2 transforms of length n1 along the columns, using out as scratch
+    columns(re, im, out_re, out_im, n1_, n2_, shuffle1_.data());
+
+    // multiply by the twiddles W_n^(i k) and transpose into n2 x n1
+    transpose(re, im, out_re, out_im);
+
+    // n1 transforms of length n2 along the columns, X[i + n1 k] ends up in row k, column i, i.e. natural order
+    columns(out_re, out_im, re, im, n2_, n1_, shuffle2_.data());
+}
+
+} /* namespace fft */
+} /* namespace audio */
+} /* namespace avis */
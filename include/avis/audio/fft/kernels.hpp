@@ -0,0 +1,533 @@
+#pragma once
+
+#include <avis/utils/cpu.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define AVIS_AUDIO_FFT_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+
+namespace avis {
+namespace audio {
+namespace fft {
+
+// Radix-2 butterfly kernels operating on split (SoA) real/imaginary data in bit-reversed order. The unit-roots
+// for all stages are stored consecutively, the roots W_{2h}^j of the stage with h butterfly-pairs start at h - 1.
+
+enum class kernel_isa {
+    scalar,
+    sse2,
+    avx2,
+    avx512,
+};
+
+template <class real_t>
+using radix2_fn = void (*)(real_t* re, real_t* im, real_t const* w_re, real_t const* w_im, std::size_t n);
+
+template <class real_t>
+using stockham_fn = void (*)(real_t* re, real_t* im, real_t* tmp_re, real_t* tmp_im, real_t const* w_re,
+        real_t const* w_im, std::size_t n);
+
+// dst[i] = sqrt(src[i]) * scale, used to turn squared norms into magnitudes; src and dst may be the same.
+template <class real_t>
+using sqrt_scale_fn = void (*)(real_t const* src, real_t* dst, std::size_t n, real_t scale);
+
+
+template <class real_t>
+inline void radix2_stage_scalar(real_t* re, real_t* im, real_t const* w_re, real_t const* w_im, std::size_t n,
+        std::size_t h)
+{
+    for (std::size_t group = 0; group < n; group += 2 * h) {
+        for (std::size_t j = 0; j < h; j++) {
+            auto const a = group + j;
+            auto const b = a + h;
+
+            auto const t_re = re[b] * w_re[j] - im[b] * w_im[j];
+            auto const t_im = re[b] * w_im[j] + im[b] * w_re[j];
+
+            re[b] = re[a] - t_re;
+            im[b] = im[a] - t_im;
+            re[a] = re[a] + t_re;
+            im[a] = im[a] + t_im;
+        }
+    }
+}
+
+template <class real_t>
+inline void radix2_scalar(real_t* re, real_t* im, real_t const* w_re, real_t const* w_im, std::size_t n) {
+    for (std::size_t h = 1; h < n; h *= 2)
+        radix2_stage_scalar(re, im, w_re + h - 1, w_im + h - 1, n, h);
+}
+
+
+// Complex sizes for which the Stockham kernels outperform the in-place radix-2 kernels including the bit-reversal
+// scatter of the input (measured with AVX2/AVX-512, the scatter starts to miss L1 at these sizes). Larger sizes are
+// decomposed into cache-sized sub-transforms, see four_step.hpp.
+constexpr std::size_t stockham_min_size = 8192;
+constexpr std::size_t stockham_max_size = 16384;
+
+constexpr auto use_stockham(std::size_t n) noexcept -> bool {
+    return n >= stockham_min_size && n <= stockham_max_size;
+}
+
+// Stockham autosort kernels operating on split (SoA) data in natural order, ping-ponging between the data and a
+// temporary buffer: all reads and writes of a stage are sequential, no bit-reversal permutation is required. The
+// stage with stride s combines the s interleaved sub-transforms of length n/s, the twiddles W_n^j for j < n/2 are
+// indexed by p * s. The result is always returned in re/im.
+
+template <class real_t>
+inline void stockham_stage_scalar(real_t const* x_re, real_t const* x_im, real_t* y_re, real_t* y_im,
+        real_t const* w_re, real_t const* w_im, std::size_t n, std::size_t s)
+{
+    auto const m = n / (2 * s);
+
+    for (std::size_t p = 0; p < m; p++) {
+        auto const wr = w_re[p * s];
+        auto const wi = w_im[p * s];
+
+        for (std::size_t q = 0; q < s; q++) {
+            auto const a = q + s * p;
+            auto const b = a + s * m;
+            auto const c = q + s * 2 * p;
+            auto const d = c + s;
+
+            auto const dr = x_re[a] - x_re[b];
+            auto const di = x_im[a] - x_im[b];
+
+            y_re[c] = x_re[a] + x_re[b];
+            y_im[c] = x_im[a] + x_im[b];
+            y_re[d] = dr * wr - di * wi;
+            y_im[d] = dr * wi + di * wr;
+        }
+    }
+}
+
+template <class real_t>
+inline void stockham_finish(real_t* re, real_t* im, real_t const* x_re, real_t const* x_im, std::size_t n) {
+    // odd number of stages: the result is in the temporary buffer
+    if (x_re != re) {
+        std::copy(x_re, x_re + n, re);
+        std::copy(x_im, x_im + n, im);
+    }
+}
+
+template <class real_t>
+inline void stockham_scalar(real_t* re, real_t* im, real_t* tmp_re, real_t* tmp_im, real_t const* w_re,
+        real_t const* w_im, std::size_t n)
+{
+    real_t* x_re = re;
+    real_t* x_im = im;
+    real_t* y_re = tmp_re;
+    real_t* y_im = tmp_im;
+
+    for (std::size_t s = 1; s < n; s *= 2) {
+        stockham_stage_scalar(x_re, x_im, y_re, y_im, w_re, w_im, n, s);
+        std::swap(x_re, y_re);
+        std::swap(x_im, y_im);
+    }
+
+    stockham_finish(re, im, x_re, x_im, n);
+}
+
+template <class real_t>
+inline void sqrt_scale_scalar(real_t const* src, real_t* dst, std::size_t n, real_t scale) {
+    for (std::size_t i = 0; i < n; i++)
+        dst[i] = std::sqrt(src[i]) * scale;
+}
+
+
+#ifdef AVIS_AUDIO_FFT_X86_KERNELS
+
+__attribute__((target("sse2")))
+inline void radix2_sse2(float* re, float* im, float const* w_re, float const* w_im, std::size_t n) {
+    std::size_t h = 1;
+
+    // stages with less than one vector of pairs
+    for (; h < 4 && h < n; h *= 2)
+        radix2_stage_scalar(re, im, w_re + h - 1, w_im + h - 1, n, h);
+
+    for (; h < n; h *= 2) {
+        auto const stage_re = w_re + h - 1;
+        auto const stage_im = w_im + h - 1;
+
+        for (std::size_t group = 0; group < n; group += 2 * h) {
+            for (std::size_t j = 0; j < h; j += 4) {
+                auto const a = group + j;
+                auto const b = a + h;
+
+                auto const wr = _mm_loadu_ps(stage_re + j);
+                auto const wi = _mm_loadu_ps(stage_im + j);
+                auto const ar = _mm_loadu_ps(re + a);
+                auto const ai = _mm_loadu_ps(im + a);
+                auto const br = _mm_loadu_ps(re + b);
+                auto const bi = _mm_loadu_ps(im + b);
+
+                auto const tr = _mm_sub_ps(_mm_mul_ps(br, wr), _mm_mul_ps(bi, wi));
+                auto const ti = _mm_add_ps(_mm_mul_ps(br, wi), _mm_mul_ps(bi, wr));
+
+                _mm_storeu_ps(re + b, _mm_sub_ps(ar, tr));
+                _mm_storeu_ps(im + b, _mm_sub_ps(ai, ti));
+                _mm_storeu_ps(re + a, _mm_add_ps(ar, tr));
+                _mm_storeu_ps(im + a, _mm_add_ps(ai, ti));
+            }
+        }
+    }
+}
+
+__attribute__((target("avx2,fma")))
+inline void radix2_avx2(float* re, float* im, float const* w_re, float const* w_im, std::size_t n) {
+    std::size_t h = 1;
+
+    // stages with less than one vector of pairs
+    for (; h < 8 && h < n; h *= 2)
+        radix2_stage_scalar(re, im, w_re + h - 1, w_im + h - 1, n, h);
+
+    for (; h < n; h *= 2) {
+        auto const stage_re = w_re + h - 1;
+        auto const stage_im = w_im + h - 1;
+
+        for (std::size_t group = 0; group < n; group += 2 * h) {
+            for (std::size_t j = 0; j < h; j += 8) {
+                auto const a = group + j;
+                auto const b = a + h;
+
+                auto const wr = _mm256_loadu_ps(stage_re + j);
+                auto const wi = _mm256_loadu_ps(stage_im + j);
+                auto const ar = _mm256_loadu_ps(re + a);
+                auto const ai = _mm256_loadu_ps(im + a);
+                auto const br = _mm256_loadu_ps(re + b);
+                auto const bi = _mm256_loadu_ps(im + b);
+
+                auto const tr = _mm256_fmsub_ps(br, wr, _mm256_mul_ps(bi, wi));
+                auto const ti = _mm256_fmadd_ps(br, wi, _mm256_mul_ps(bi, wr));
+
+                _mm256_storeu_ps(re + b, _mm256_sub_ps(ar, tr));
+                _mm256_storeu_ps(im + b, _mm256_sub_ps(ai, ti));
+                _mm256_storeu_ps(re + a, _mm256_add_ps(ar, tr));
+                _mm256_storeu_ps(im + a, _mm256_add_ps(ai, ti));
+            }
+        }
+    }
+}
+
+__attribute__((target("avx512f")))
+inline void radix2_avx512(float* re, float* im, float const* w_re, float const* w_im, std::size_t n) {
+    std::size_t h = 1;
+
+    // stages with less than one vector of pairs
+    for (; h < 16 && h < n; h *= 2)
+        radix2_stage_scalar(re, im, w_re + h - 1, w_im + h - 1, n, h);
+
+    for (; h < n; h *= 2) {
+        auto const stage_re = w_re + h - 1;
+        auto const stage_im = w_im + h - 1;
+
+        for (std::size_t group = 0; group < n; group += 2 * h) {
+            for (std::size_t j = 0; j < h; j += 16) {
+                auto const a = group + j;
+                auto const b = a + h;
+
+                auto const wr = _mm512_loadu_ps(stage_re + j);
+                auto const wi = _mm512_loadu_ps(stage_im + j);
+                auto const ar = _mm512_loadu_ps(re + a);
+                auto const ai = _mm512_loadu_ps(im + a);
+                auto const br = _mm512_loadu_ps(re + b);
+                auto const bi = _mm512_loadu_ps(im + b);
+
+                auto const tr = _mm512_fmsub_ps(br, wr, _mm512_mul_ps(bi, wi));
+                auto const ti = _mm512_fmadd_ps(br, wi, _mm512_mul_ps(bi, wr));
+
+                _mm512_storeu_ps(re + b, _mm512_sub_ps(ar, tr));
+                _mm512_storeu_ps(im + b, _mm512_sub_ps(ai, ti));
+                _mm512_storeu_ps(re + a, _mm512_add_ps(ar, tr));
+                _mm512_storeu_ps(im + a, _mm512_add_ps(ai, ti));
+            }
+        }
+    }
+}
+
+__attribute__((target("sse2")))
+inline void stockham_sse2(float* re, float* im, float* tmp_re, float* tmp_im, float const* w_re, float const* w_im,
+        std::size_t n)
+{
+    float* x_re = re;
+    float* x_im = im;
+    float* y_re = tmp_re;
+    float* y_im = tmp_im;
+
+    for (std::size_t s = 1; s < n; s *= 2) {
+        // stages with less than one vector of interleaved sub-transforms
+        if (s < 4) {
+            stockham_stage_scalar(x_re, x_im, y_re, y_im, w_re, w_im, n, s);
+        } else {
+            auto const m = n / (2 * s);
+
+            for (std::size_t p = 0; p < m; p++) {
+                auto const wr = _mm_set1_ps(w_re[p * s]);
+                auto const wi = _mm_set1_ps(w_im[p * s]);
+
+                auto const a = s * p;
+                auto const b = a + s * m;
+                auto const c = s * 2 * p;
+                auto const d = c + s;
+
+                for (std::size_t q = 0; q < s; q += 4) {
+                    auto const ar = _mm_loadu_ps(x_re + a + q);
+                    auto const ai = _mm_loadu_ps(x_im + a + q);
+                    auto const br = _mm_loadu_ps(x_re + b + q);
+                    auto const bi = _mm_loadu_ps(x_im + b + q);
+
+                    auto const dr = _mm_sub_ps(ar, br);
+                    auto const di = _mm_sub_ps(ai, bi);
+
+                    _mm_storeu_ps(y_re + c + q, _mm_add_ps(ar, br));
+                    _mm_storeu_ps(y_im + c + q, _mm_add_ps(ai, bi));
+                    _mm_storeu_ps(y_re + d + q, _mm_sub_ps(_mm_mul_ps(dr, wr), _mm_mul_ps(di, wi)));
+                    _mm_storeu_ps(y_im + d + q, _mm_add_ps(_mm_mul_ps(dr, wi), _mm_mul_ps(di, wr)));
+                }
+            }
+        }
+
+        std::swap(x_re, y_re);
+        std::swap(x_im, y_im);
+    }
+
+    stockham_finish(re, im, x_re, x_im, n);
+}
+
+__attribute__((target("avx2,fma")))
+inline void stockham_avx2(float* re, float* im, float* tmp_re, float* tmp_im, float const* w_re, float const* w_im,
+        std::size_t n)
+{
+    float* x_re = re;
+    float* x_im = im;
+    float* y_re = tmp_re;
+    float* y_im = tmp_im;
+
+    for (std::size_t s = 1; s < n; s *= 2) {
+        // stages with less than one vector of interleaved sub-transforms
+        if (s < 8) {
+            stockham_stage_scalar(x_re, x_im, y_re, y_im, w_re, w_im, n, s);
+        } else {
+            auto const m = n / (2 * s);
+
+            for (std::size_t p = 0; p < m; p++) {
+                auto const wr = _mm256_set1_ps(w_re[p * s]);
+                auto const wi = _mm256_set1_ps(w_im[p * s]);
+
+                auto const a = s * p;
+                auto const b = a + s * m;
+                auto const c = s * 2 * p;
+                auto const d = c + s;
+
+                for (std::size_t q = 0; q < s; q += 8) {
+                    auto const ar = _mm256_loadu_ps(x_re + a + q);
+                    auto const ai = _mm256_loadu_ps(x_im + a + q);
+                    auto const br = _mm256_loadu_ps(x_re + b + q);
+                    auto const bi = _mm256_loadu_ps(x_im + b + q);
+
+                    auto const dr = _mm256_sub_ps(ar, br);
+                    auto const di = _mm256_sub_ps(ai, bi);
+
+                    _mm256_storeu_ps(y_re + c + q, _mm256_add_ps(ar, br));
+                    _mm256_storeu_ps(y_im + c + q, _mm256_add_ps(ai, bi));
+                    _mm256_storeu_ps(y_re + d + q, _mm256_fmsub_ps(dr, wr, _mm256_mul_ps(di, wi)));
+                    _mm256_storeu_ps(y_im + d + q, _mm256_fmadd_ps(dr, wi, _mm256_mul_ps(di, wr)));
+                }
+            }
+        }
+
+        std::swap(x_re, y_re);
+        std::swap(x_im, y_im);
+    }
+
+    stockham_finish(re, im, x_re, x_im, n);
+}
+
+__attribute__((target("avx512f")))
+inline void stockham_avx512(float* re, float* im, float* tmp_re, float* tmp_im, float const* w_re, float const* w_im,
+        std::size_t n)
+{
+    float* x_re = re;
+    float* x_im = im;
+    float* y_re = tmp_re;
+    float* y_im = tmp_im;
+
+    for (std::size_t s = 1; s < n; s *= 2) {
+        // stages with less than one vector of interleaved sub-transforms
+        if (s < 16) {
+            stockham_stage_scalar(x_re, x_im, y_re, y_im, w_re, w_im, n, s);
+        } else {
+            auto const m = n / (2 * s);
+
+            for (std::size_t p = 0; p < m; p++) {
+                auto const wr = _mm512_set1_ps(w_re[p * s]);
+                auto const wi = _mm512_set1_ps(w_im[p * s]);
+
+                auto const a = s * p;
+                auto const b = a + s * m;
+                auto const c = s * 2 * p;
+                auto const d = c + s;
+
+                for (std::size_t q = 0; q < s; q += 16) {
+                    auto const ar = _mm512_loadu_ps(x_re + a + q);
+                    auto const ai = _mm512_loadu_ps(x_im + a + q);
+                    auto const br = _mm512_loadu_ps(x_re + b + q);
+                    auto const bi = _mm512_loadu_ps(x_im + b + q);
+
+                    auto const dr = _mm512_sub_ps(ar, br);
+                    auto const di = _mm512_sub_ps(ai, bi);
+
+                    _mm512_storeu_ps(y_re + c + q, _mm512_add_ps(ar, br));
+                    _mm512_storeu_ps(y_im + c + q, _mm512_add_ps(ai, bi));
+                    _mm512_storeu_ps(y_re + d + q, _mm512_fmsub_ps(dr, wr, _mm512_mul_ps(di, wi)));
+                    _mm512_storeu_ps(y_im + d + q, _mm512_fmadd_ps(dr, wi, _mm512_mul_ps(di, wr)));
+                }
+            }
+        }
+
+        std::swap(x_re, y_re);
+        std::swap(x_im, y_im);
+    }
+
+    stockham_finish(re, im, x_re, x_im, n);
+}
+
+__attribute__((target("sse2")))
+inline void sqrt_scale_sse2(float const* src, float* dst, std::size_t n, float scale) {
+    auto const s = _mm_set1_ps(scale);
+
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_sqrt_ps(_mm_loadu_ps(src + i)), s));
+
+    sqrt_scale_scalar(src + i, dst + i, n - i, scale);
+}
+
+__attribute__((target("avx2,fma")))
+inline void sqrt_scale_avx2(float const* src, float* dst, std::size_t n, float scale) {
+    auto const s = _mm256_set1_ps(scale);
+
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_sqrt_ps(_mm256_loadu_ps(src + i)), s));
+
+    sqrt_scale_scalar(src + i, dst + i, n - i, scale);
+}
+
+__attribute__((target("avx512f")))
+inline void sqrt_scale_avx512(float const* src, float* dst, std::size_t n, float scale) {
+    auto const s = _mm512_set1_ps(scale);
+
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+        _mm512_storeu_ps(dst + i, _mm512_mul_ps(_mm512_maskz_sqrt_ps(0xffff, _mm512_loadu_ps(src + i)), s));
+
+    // remainder using a masked load/store
+    if (i < n) {
+        auto const mask = static_cast<__mmask16>((1u << (n - i)) - 1);
+        auto const v = _mm512_maskz_loadu_ps(mask, src + i);
+        _mm512_mask_storeu_ps(dst + i, mask, _mm512_mul_ps(_mm512_maskz_sqrt_ps(mask, v), s));
+    }
+}
+
+#endif /* AVIS_AUDIO_FFT_X86_KERNELS */
+
+
+inline auto select_kernel_isa() noexcept -> kernel_isa {
+#ifdef AVIS_AUDIO_FFT_X86_KERNELS
+    auto const& cpu = utils::get_cpu_features();
+
+    if (cpu.avx512f)
+        return kernel_isa::avx512;
+    else if (cpu.avx2 && cpu.fma)
+        return kernel_isa::avx2;
+    else if (cpu.sse2)
+        return kernel_isa::sse2;
+#endif
+
+    return kernel_isa::scalar;
+}
+
+inline auto get_kernel_isa() noexcept -> kernel_isa {
+    static auto const isa = select_kernel_isa();
+    return isa;
+}
+
+
+template <class real_t>
+struct kernels {
+    static auto radix2() noexcept -> radix2_fn<real_t> {
+        return radix2_scalar<real_t>;
+    }
+
+    static auto stockham() noexcept -> stockham_fn<real_t> {
+        return stockham_scalar<real_t>;
+    }
+
+    static auto sqrt_scale() noexcept -> sqrt_scale_fn<real_t> {
+        return sqrt_scale_scalar<real_t>;
+    }
+};
+
+template <>
+struct kernels<float> {
+    static auto radix2() noexcept -> radix2_fn<float> {
+        static auto const fn = select_radix2();
+        return fn;
+    }
+
+    static auto stockham() noexcept -> stockham_fn<float> {
+        static auto const fn = select_stockham();
+        return fn;
+    }
+
+    static auto sqrt_scale() noexcept -> sqrt_scale_fn<float> {
+        static auto const fn = select_sqrt_scale();
+        return fn;
+    }
+
+private:
+    static auto select_radix2() noexcept -> radix2_fn<float> {
+        switch (get_kernel_isa()) {
+#ifdef AVIS_AUDIO_FFT_X86_KERNELS
+        case kernel_isa::avx512:    return radix2_avx512;
+        case kernel_isa::avx2:      return radix2_avx2;
+        case kernel_isa::sse2:      return radix2_sse2;
+#endif
+        default:                    return radix2_scalar<float>;
+        }
+    }
+
+    static auto select_stockham() noexcept -> stockham_fn<float> {
+        switch (get_kernel_isa()) {
+#ifdef AVIS_AUDIO_FFT_X86_KERNELS
+        case kernel_isa::avx512:    return stockham_avx512;
+        case kernel_isa::avx2:      return stockham_avx2;
+        case kernel_isa::sse2:      return stockham_sse2;
+#endif
+        default:                    return stockham_scalar<float>;
+        }
+    }
+
+    static auto select_sqrt_scale() noexcept -> sqrt_scale_fn<float> {
+        switch (get_kernel_isa()) {
+#ifdef AVIS_AUDIO_FFT_X86_KERNELS
+        case kernel_isa::avx512:    return sqrt_scale_avx512;
+        case kernel_isa::avx2:      return sqrt_scale_avx2;
+        case kernel_isa::sse2:      return sqrt_scale_sse2;
+#endif
+        default:                    return sqrt_scale_scalar<float>;
+        }
+    }
+};
+
+} /* namespace fft */
+} /* namespace audio */
+} /* namespace avis */
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <avis/utils/constexpr_math.hpp>
+
+#include <cmath>
+#include <complex>
+#include <utility>
+#include <vector>
+
+
+namespace avis {
+namespace audio {
+namespace fft {
+
+// Complex multiplication without the NaN/infinity recovery of std::complex's operator*.
+template <class real_t>
+inline auto cmul(std::complex<real_t> const& a, std::complex<real_t> const& b) noexcept -> std::complex<real_t> {
+    return {a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real()};
+}
+
+
+// Out-of-place forward complex FFT for sizes with prime factors 2, 3 and 5 only, using a recursive
+// decimation-in-time over the factors (radix 4, 2, 3 and 5). The output is in natural order.
+template <class real_t>
+class mixed_radix_plan {
+public:
+    using complex_type = std::complex<real_t>;
+
+    static inline auto supports(std::size_t n) noexcept -> bool;
+
+    mixed_radix_plan()
+            : size_{0}
+            , factors_{}
+            , twiddles_{} {}
+
+    explicit inline mixed_radix_plan(std::size_t n);
+
+    inline auto size() const noexcept -> std::size_t;
+
+    inline void execute(complex_type const* in, complex_type* out) const;
+
+private:
+    struct factor {
+        std::size_t radix;
+        std::size_t stride;     // remaining length after this factor
+    };
+
+    inline void work(complex_type* out, complex_type const* in, std::size_t fstride, std::size_t stage) const;
+
+    inline void butterfly2(complex_type* out, std::size_t fstride, std::size_t m) const;
+    inline void butterfly3(complex_type* out, std::size_t fstride, std::size_t m) const;
+    inline void butterfly4(complex_type* out, std::size_t fstride, std::size_t m) const;
+    inline void butterfly5(complex_type* out, std::size_t fstride, std::size_t m) const;
+
+    std::size_t               size_;
+    std::vector<factor>       factors_;
+    std::vector<complex_type> twiddles_;
+};
+
+
+template <class real_t>
+auto mixed_radix_plan<real_t>::supports(std::size_t n) noexcept -> bool {
+    if (n == 0)
+        return false;
+
+    for (std::size_t p : {2, 3, 5})
+        while (n % p == 0)
+            n /= p;
+
+    return n == 1;
+}
+
+template <class real_t>
+mixed_radix_plan<real_t>::mixed_radix_plan(std::size_t n)
+        : size_{n}
+        , factors_{}
+        , twiddles_(n)
+{
+    // factorize, prefer radix 4 over radix 2
+    std::size_t m = n;
+    while (m > 1) {
+        std::size_t p = m % 4 == 0 ? 4 : m % 2 == 0 ? 2 : m % 3 == 0 ? 3 : 5;
+        m /= p;
+        factors_.push_back({p, m});
+    }
+
+    for (std::size_t k = 0; k < n; k++) {
+        double const arg = -2.0 * math::pi<double> * k / n;
+        twiddles_[k] = {static_cast<real_t>(std::cos(arg)), static_cast<real_t>(std::sin(arg))};
+    }
+}
+
+template <class real_t>
+auto mixed_radix_plan<real_t>::size() const noexcept -> std::size_t {
+    return size_;
+}
+
+template <class real_t>
+void mixed_radix_plan<real_t>::execute(complex_type const* in, complex_type* out) const {
+    if (size_ == 1)
+        out[0] = in[0];
+    else if (size_ > 1)
+        work(out, in, 1, 0);
+}
+
+template <class real_t>
+void mixed_radix_plan<real_t>::work(complex_type* out, complex_type const* in, std::size_t fstride,
+        std::size_t stage) const
+{
+    auto const p = factors_[stage].radix;
+    auto const m = factors_[stage].stride;
+
+    // transform the p decimated sub-sequences of length m, each into its own block of the output
+    if (m == 1) {
+        for (std::size_t i = 0; i < p; i++)
+            out[i] = in[i * fstride];
+    } else {
+        for (std::size_t i = 0; i < p; i++)
+            work(out + i * m, in + i * fstride, fstride * p, stage + 1);
+    }
+
+    // recombine them
+    switch (p) {
+    case 2: butterfly2(out, fstride, m); break;
+    case 3: butterfly3(out, fstride, m); break;
+    case 4: butterfly4(out, fstride, m); break;
+    case 5: butterfly5(out, fstride, m); break;
+    }
+}
+
+template <class real_t>
+void mixed_radix_plan<real_t>::butterfly2(complex_type* out, std::size_t fstride, std::size_t m) const {
+    auto const tw = twiddles_.data();
+
+    for (std::size_t k = 0; k < m; k++) {
+        auto const t = cmul(out[k + m], tw[k * fstride]);
+        out[k + m] = out[k] - t;
+        out[k]    += t;
+    }
+}
+
+template <class real_t>
+void mixed_radix_plan<real_t>::butterfly3(complex_type* out, std::size_t fstride, std::size_t m) const {
+    auto const tw = twiddles_.data();
+    auto const epi3 = tw[fstride * m].imag();
+
+    for (std::size_t k = 0; k < m; k++) {
+        auto const s1 = cmul(out[k + m],     tw[k * fstride]);
+        auto const s2 = cmul(out[k + 2 * m], tw[k * fstride * 2]);
+        auto const s3 = s1 + s2;
+        auto const s0 = (s1 - s2) * epi3;
+
+        auto const h = out[k] - s3 * static_cast<real_t>(0.5);
+        out[k] += s3;
+
+        out[k + m]     = {h.real() - s0.imag(), h.imag() + s0.real()};
+        out[k + 2 * m] = {h.real() + s0.imag(), h.imag() - s0.real()};
+    }
+}
+
+template <class real_t>
+void mixed_radix_plan<real_t>::butterfly4(complex_type* out, std::size_t fstride, std::size_t m) const {
+    auto const tw = twiddles_.data();
+
+    for (std::size_t k = 0; k < m; k++) {
+        auto const s0 = cmul(out[k + m],     tw[k * fstride]);
+        auto const s1 = cmul(out[k + 2 * m], tw[k * fstride * 2]);
+        auto const s2 = cmul(out[k + 3 * m], tw[k * fstride * 3]);
+
+        auto const s5 = out[k] - s1;
+        auto const a  = out[k] + s1;
+        auto const s3 = s0 + s2;
+        auto const s4 = s0 - s2;
+
+        out[k]         = a + s3;
+        out[k + 2 * m] = a - s3;
+        out[k + m]     = {s5.real() + s4.imag(), s5.imag() - s4.real()};
+        out[k + 3 * m] = {s5.real() - s4.imag(), s5.imag() + s4.real()};
+    }
+}
+
+template <class real_t>
+void mixed_radix_plan<real_t>::butterfly5(complex_type* out, std::size_t fstride, std::size_t m) const {
+    auto const tw = twiddles_.data();
+    auto const ya = tw[fstride * m];
+    auto const yb = tw[fstride * m * 2];
+
+    for (std::size_t k = 0; k < m; k++) {
+        auto const s0 = out[k];
+        auto const s1 = cmul(out[k + m],     tw[k * fstride]);
+        auto const s2 = cmul(out[k + 2 * m], tw[k * fstride * 2]);
+        auto const s3 = cmul(out[k + 3 * m], tw[k * fstride * 3]);
+        auto const s4 = cmul(out[k + 4 * m], tw[k * fstride * 4]);
+
+        auto const s7  = s1 + s4;
+        auto const s10 = s1 - s4;
+        auto const s8  = s2 + s3;
+        auto const s9  = s2 - s3;
+
+        out[k] = s0 + s7 + s8;
+
+        auto const s5  = complex_type{s0.real() + s7.real() * ya.real() + s8.real() * yb.real(),
+                                      s0.imag() + s7.imag() * ya.real() + s8.imag() * yb.real()};
+        auto const s6  = complex_type{s10.imag() * ya.imag() + s9.imag() * yb.imag(),
+                                      -s10.real() * ya.imag() - s9.real() * yb.imag()};
+        auto const s11 = complex_type{s0.real() + s7.real() * yb.real() + s8.real() * ya.real(),
+                                      s0.imag() + s7.imag() * yb.real() + s8.imag() * ya.real()};
+        auto const s12 = complex_type{-s10.imag() * yb.imag() + s9.imag() * ya.imag(),
+                                      s10.real() * yb.imag() - s9.real() * ya.imag()};
+
+        out[k + m]     = s5 - s6;
+        out[k + 4 * m] = s5 + s6;
+        out[k + 2 * m] = s11 + s12;
+        out[k + 3 * m] = s11 - s12;
+    }
+}
+
+} /* namespace fft */
+} /* namespace audio */
+} /* namespace avis */
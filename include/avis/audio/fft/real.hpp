@@ -0,0 +1,230 @@
+#pragma once
+
+#include <avis/audio/fft/kernels.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
+
+namespace avis {
+namespace audio {
+
+// Output of the real FFT per bin: the magnitude |X|, the power |X|^2 (sqrt-free), or the magnitude approximated
+// using alpha-max-plus-beta-min (sqrt-free, maximum error about 4%).
+enum class magnitude_mode {
+    magnitude,
+    power,
+    approximate,
+};
+
+namespace fft {
+
+// Helpers for transforming real input with a complex FFT: for even n, the windowed input is packed into n/2
+// complex values (even samples as real, odd samples as imaginary part), the resulting spectrum Z is then split
+// into the spectra of the even and odd samples and recombined to X[k] = E[k] + W_n^k * O[k] for k <= n/2.
+
+template <class real_t, class InputIterator, class Index>
+inline void pack_shuffled(InputIterator src, real_t const* window, Index const* shuffle, real_t* re, real_t* im,
+        std::size_t n)
+{
+    for (std::size_t i = 0; i < n / 2; i++) {
+        re[shuffle[i]] = *(src++) * window[2 * i];
+        im[shuffle[i]] = *(src++) * window[2 * i + 1];
+    }
+}
+
+template <class real_t, class InputIterator>
+inline void pack_split(InputIterator src, real_t const* window, real_t* re, real_t* im, std::size_t n) {
+    for (std::size_t i = 0; i < n / 2; i++) {
+        re[i] = *(src++) * window[2 * i];
+        im[i] = *(src++) * window[2 * i + 1];
+    }
+}
+
+template <class real_t, class InputIterator>
+inline void pack_complex(InputIterator src, real_t const* window, std::complex<real_t>* out, std::size_t n) {
+    if (n % 2 == 0) {
+        for (std::size_t i = 0; i < n / 2; i++) {
+            auto const re = *(src++) * window[2 * i];
+            auto const im = *(src++) * window[2 * i + 1];
+            out[i] = {re, im};
+        }
+    } else {
+        // odd n: full complex transform of the real input
+        for (std::size_t i = 0; i < n; i++)
+            out[i] = {*(src++) * window[i], 0};
+    }
+}
+
+// Stereo: both channels are transformed using one complex FFT of size n, with the windowed left channel as real
+// and the right channel as imaginary part. The spectra are separated afterwards using the conjugate symmetry of
+// the spectrum of real input, L[k] = (Z[k] + Z*[n-k]) / 2 and R[k] = (Z[k] - Z*[n-k]) / 2i.
+
+template <class real_t, class InputIterator, class Index>
+inline void pack_stereo_shuffled(InputIterator left, InputIterator right, real_t const* window, Index const* shuffle,
+        real_t* re, real_t* im, std::size_t n)
+{
+    for (std::size_t i = 0; i < n; i++) {
+        re[shuffle[i]] = *(left++)  * window[i];
+        im[shuffle[i]] = *(right++) * window[i];
+    }
+}
+
+template <class real_t, class InputIterator>
+inline void pack_stereo_split(InputIterator left, InputIterator right, real_t const* window, real_t* re, real_t* im,
+        std::size_t n)
+{
+    for (std::size_t i = 0; i < n; i++) {
+        re[i] = *(left++)  * window[i];
+        im[i] = *(right++) * window[i];
+    }
+}
+
+template <class real_t, class InputIterator>
+inline void pack_stereo_complex(InputIterator left, InputIterator right, real_t const* window,
+        std::complex<real_t>* out, std::size_t n)
+{
+    for (std::size_t i = 0; i < n; i++) {
+        auto const re = *(left++)  * window[i];
+        auto const im = *(right++) * window[i];
+        out[i] = {re, im};
+    }
+}
+
+// Norms applied to the unpacked bins, scaled by the transform scale (squared for power).
+template <class real_t>
+struct norm_power {
+    real_t scale;
+
+    auto operator() (std::complex<real_t> const& x) const noexcept -> real_t {
+        return (x.real() * x.real() + x.imag() * x.imag()) * scale;
+    }
+};
+
+// the scaled bins themselves, for further processing of the complex spectrum
+template <class real_t>
+struct norm_complex {
+    real_t scale;
+
+    auto operator() (std::complex<real_t> const& x) const noexcept -> std::complex<real_t> {
+        return x * scale;
+    }
+};
+
+// alpha * max(|re|, |im|) + beta * min(|re|, |im|), coefficients minimizing the maximum error (about 4%)
+template <class real_t>
+struct norm_approximate {
+    real_t scale;
+
+    auto operator() (std::complex<real_t> const& x) const noexcept -> real_t {
+        constexpr auto alpha = static_cast<real_t>(0.96043387010342);
+        constexpr auto beta  = static_cast<real_t>(0.39782473475813);
+
+        auto const a = std::abs(x.real());
+        auto const b = std::abs(x.imag());
+        return (alpha * std::max(a, b) + beta * std::min(a, b)) * scale;
+    }
+};
+
+
+template <class real_t, class Fn, class Norm, class OutputIterator>
+inline void unpack_norm(Fn z, std::complex<real_t> const* roots, std::size_t n, Norm norm, OutputIterator dst) {
+    // odd n: full complex transform of the real input, the first n/2 + 1 bins are non-redundant
+    if (n % 2 != 0) {
+        for (std::size_t k = 0; k < n / 2 + 1; k++)
+            *(dst++) = norm(z(k));
+
+        return;
+    }
+
+    auto const m = n / 2;
+
+    // split into even/odd spectra and combine them: X[k] = E[k] + W_n^k * O[k]
+    auto const z0 = z(0);
+    *(dst++) = norm(std::complex<real_t>{z0.real() + z0.imag(), 0});
+
+    for (std::size_t k = 1; k < m; k++) {
+        auto const a = z(k);
+        auto const b = std::conj(z(m - k));
+
+        auto const even = (a + b) * static_cast<real_t>(0.5);
+        auto const odd  = (a - b) * std::complex<real_t>{0.0, -0.5};
+
+        *(dst++) = norm(even + roots[k] * odd);
+    }
+
+    *(dst++) = norm(std::complex<real_t>{z0.real() - z0.imag(), 0});
+}
+
+template <class real_t, class Fn, class Norm, class OutputIterator>
+inline void unpack_stereo_norm(Fn z, std::size_t n, Norm norm, OutputIterator dst_left, OutputIterator dst_right) {
+    for (std::size_t k = 0; k < n / 2 + 1; k++) {
+        auto const a = z(k);
+        auto const b = std::conj(z(k == 0 ? 0 : n - k));
+
+        *(dst_left++)  = norm((a + b) * static_cast<real_t>(0.5));
+        *(dst_right++) = norm((a - b) * std::complex<real_t>{0.0, -0.5});
+    }
+}
+
+template <class real_t>
+inline void store_sqrt(real_t* norms, std::size_t count, real_t scale, real_t* dst) {
+    kernels<real_t>::sqrt_scale()(norms, dst, count, scale);
+}
+
+template <class real_t, class OutputIterator>
+inline void store_sqrt(real_t* norms, std::size_t count, real_t scale, OutputIterator dst) {
+    kernels<real_t>::sqrt_scale()(norms, norms, count, scale);
+    std::copy(norms, norms + count, dst);
+}
+
+// Unpack the n/2 + 1 non-redundant bins and write them to dst according to the magnitude mode. The exact
+// magnitude is computed from the squared norms stored in scratch (n/2 + 1 elements) using a vectorized sqrt.
+template <class real_t, class Fn, class OutputIterator>
+inline void unpack_magnitude(Fn z, std::complex<real_t> const* roots, std::size_t n, real_t scale,
+        magnitude_mode mode, real_t* scratch, OutputIterator dst)
+{
+    switch (mode) {
+    case magnitude_mode::power:
+        unpack_norm(z, roots, n, norm_power<real_t>{scale * scale}, dst);
+        break;
+
+    case magnitude_mode::approximate:
+        unpack_norm(z, roots, n, norm_approximate<real_t>{scale}, dst);
+        break;
+
+    case magnitude_mode::magnitude:
+        unpack_norm(z, roots, n, norm_power<real_t>{1}, scratch);
+        store_sqrt(scratch, n / 2 + 1, scale, dst);
+        break;
+    }
+}
+
+// Stereo equivalent of unpack_magnitude, scratch must provide 2 (n/2 + 1) elements.
+template <class real_t, class Fn, class OutputIterator>
+inline void unpack_stereo_magnitude(Fn z, std::size_t n, real_t scale, magnitude_mode mode, real_t* scratch,
+        OutputIterator dst_left, OutputIterator dst_right)
+{
+    auto const count = n / 2 + 1;
+
+    switch (mode) {
+    case magnitude_mode::power:
+        unpack_stereo_norm<real_t>(z, n, norm_power<real_t>{scale * scale}, dst_left, dst_right);
+        break;
+
+    case magnitude_mode::approximate:
+        unpack_stereo_norm<real_t>(z, n, norm_approximate<real_t>{scale}, dst_left, dst_right);
+        break;
+
+    case magnitude_mode::magnitude:
+        unpack_stereo_norm<real_t>(z, n, norm_power<real_t>{1}, scratch, scratch + count);
+        store_sqrt(scratch, count, scale, dst_left);
+        store_sqrt(scratch + count, count, scale, dst_right);
+        break;
+    }
+}
+
+} /* namespace fft */
+} /* namespace audio */
+} /* namespace avis */
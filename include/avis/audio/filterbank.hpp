@@ -0,0 +1,299 @@
+#pragma once
+
+#include <avis/audio/fft.hpp>
+#include <avis/audio/fft/kernels.hpp>
+#include <avis/utils/cpu.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+
+namespace avis {
+namespace audio {
+
+// Frequency axis of the displayed spectrum: the FFT bins themselves (linear), bands equally spaced on the mel or a
+// logarithmic scale, the bins of a constant-Q transform (see constant_q_transform in cqt.hpp), or octave bands of
+// FFTs at successively lower sample rates (see multires_plan in multires.hpp).
+enum class frequency_scale {
+    linear,
+    mel,
+    log,
+    constant_q,
+    multires,
+};
+
+
+namespace filterbank_kernels {
+
+// Sparse matrix-vector product dst = W src for a matrix in CSR format where the non-zeros of each row are
+// consecutive: row r has offsets[r + 1] - offsets[r] weights, applied to src starting at columns[r].
+template <class real_t>
+using apply_fn = void (*)(real_t const* src, real_t* dst, std::uint32_t const* offsets,
+        std::uint32_t const* columns, real_t const* weights, std::size_t rows);
+
+template <class real_t>
+inline void apply_scalar(real_t const* src, real_t* dst, std::uint32_t const* offsets, std::uint32_t const* columns,
+        real_t const* weights, std::size_t rows)
+{
+    for (std::size_t r = 0; r < rows; r++) {
+        auto const w = weights + offsets[r];
+        auto const x = src + columns[r];
+        auto const n = offsets[r + 1] - offsets[r];
+
+        auto acc = real_t{0};
+        for (std::size_t i = 0; i < n; i++)
+            acc += w[i] * x[i];
+
+        dst[r] = acc;
+    }
+}
+
+
+#ifdef AVIS_AUDIO_FFT_X86_KERNELS
+
+__attribute__((target("avx2,fma")))
+inline void apply_avx2(float const* src, float* dst, std::uint32_t const* offsets, std::uint32_t const* columns,
+        float const* weights, std::size_t rows)
+{
+    for (std::size_t r = 0; r < rows; r++) {
+        auto const w = weights + offsets[r];
+        auto const x = src + columns[r];
+        auto const n = offsets[r + 1] - offsets[r];
+
+        auto acc = _mm256_setzero_ps();
+
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+            acc = _mm256_fmadd_ps(_mm256_loadu_ps(w + i), _mm256_loadu_ps(x + i), acc);
+
+        // horizontal sum
+        auto sum4 = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+        sum4 = _mm_add_ps(sum4, _mm_movehl_ps(sum4, sum4));
+        sum4 = _mm_add_ss(sum4, _mm_shuffle_ps(sum4, sum4, 1));
+
+        auto sum = _mm_cvtss_f32(sum4);
+        for (; i < n; i++)
+            sum += w[i] * x[i];
+
+        dst[r] = sum;
+    }
+}
+
+__attribute__((target("avx512f")))
+inline void apply_avx512(float const* src, float* dst, std::uint32_t const* offsets, std::uint32_t const* columns,
+        float const* weights, std::size_t rows)
+{
+    for (std::size_t r = 0; r < rows; r++) {
+        auto const w = weights + offsets[r];
+        auto const x = src + columns[r];
+        auto const n = offsets[r + 1] - offsets[r];
+
+        auto acc = _mm512_setzero_ps();
+
+        std::size_t i = 0;
+        for (; i + 16 <= n; i += 16)
+            acc = _mm512_fmadd_ps(_mm512_loadu_ps(w + i), _mm512_loadu_ps(x + i), acc);
+
+        // remainder using masked loads
+        if (i < n) {
+            auto const mask = static_cast<__mmask16>((1u << (n - i)) - 1);
+            acc = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, w + i), _mm512_maskz_loadu_ps(mask, x + i), acc);
+        }
+
+        // horizontal sum: fold 512 to 128 bit, then within the lower lane
+        acc = _mm512_add_ps(acc, _mm512_maskz_shuffle_f32x4(0xffff, acc, acc, 0x4e));
+        acc = _mm512_add_ps(acc, _mm512_maskz_shuffle_f32x4(0xffff, acc, acc, 0xb1));
+
+        auto sum4 = _mm512_maskz_extractf32x4_ps(0xf, acc, 0);
+        sum4 = _mm_add_ps(sum4, _mm_movehl_ps(sum4, sum4));
+        sum4 = _mm_add_ss(sum4, _mm_shuffle_ps(sum4, sum4, 1));
+
+        dst[r] = _mm_cvtss_f32(sum4);
+    }
+}
+
+#endif /* AVIS_AUDIO_FFT_X86_KERNELS */
+
+template <class real_t>
+inline auto select_apply() noexcept -> apply_fn<real_t> {
+    return apply_scalar<real_t>;
+}
+
+template <>
+inline auto select_apply<float>() noexcept -> apply_fn<float> {
+    switch (fft::get_kernel_isa()) {
+#ifdef AVIS_AUDIO_FFT_X86_KERNELS
+    case fft::kernel_isa::avx512:   return apply_avx512;
+    case fft::kernel_isa::avx2:     return apply_avx2;
+#endif
+    default:                        return apply_scalar<float>;
+    }
+}
+
+} /* namespace filterbank_kernels */
+
+
+// Rebinning of the n/2 + 1 magnitudes of an n-point real FFT into a smaller number of bands, using triangular
+// filters with centers equally spaced on the given frequency scale between f_min and f_max. Each filter spans
+// from the center of the previous to the center of the next band and is normalized to unit sum, thus the bands
+// keep the scale of the input. Filters covering less than two bins interpolate linearly between the two bins
+// around their center. The weights are precomputed and stored as sparse matrix (see filterbank_kernels).
+template <class real_t = float>
+class filterbank {
+public:
+    filterbank()
+            : input_size_{0}
+            , offsets_{0}
+            , columns_{}
+            , weights_{} {}
+
+    inline filterbank(std::size_t n, double sample_rate, std::size_t bands, frequency_scale scale, double f_min,
+            double f_max);
+
+    inline auto input_size()  const noexcept -> std::size_t;
+    inline auto output_size() const noexcept -> std::size_t;
+
+    // number of stored weights
+    inline auto nonzeros() const noexcept -> std::size_t;
+
+    inline void apply(real_t const* src, real_t* dst) const;
+
+private:
+    static inline auto to_scale(frequency_scale scale, double f) -> double;
+    static inline auto from_scale(frequency_scale scale, double v) -> double;
+
+    std::size_t                input_size_;
+    std::vector<std::uint32_t> offsets_;
+    std::vector<std::uint32_t> columns_;
+    std::vector<real_t>        weights_;
+};
+
+
+template <class real_t>
+filterbank<real_t>::filterbank(std::size_t n, double sample_rate, std::size_t bands, frequency_scale scale,
+        double f_min, double f_max)
+        : input_size_{rfft_output_size(n)}
+        , offsets_{0}
+        , columns_{}
+        , weights_{}
+{
+    if (bands == 0)
+        throw std::invalid_argument("The filterbank requires at least one band!");
+
+    if (scale == frequency_scale::constant_q || scale == frequency_scale::multires)
+        throw std::invalid_argument("The filterbank only supports the linear, mel and log scales!");
+
+    if (!(f_min >= 0.0 && f_min < f_max) || (scale == frequency_scale::log && f_min <= 0.0))
+        throw std::invalid_argument("Invalid filterbank frequency range!");
+
+    auto const bin_width = sample_rate / n;
+    auto const last_bin  = static_cast<double>(input_size_ - 1);
+
+    // band edges: centers of the neighbouring bands, in units of bins
+    auto const v_min = to_scale(scale, f_min);
+    auto const v_max = to_scale(scale, f_max);
+
+    auto edges = std::vector<double>(bands + 2);
+    for (std::size_t i = 0; i < bands + 2; i++) {
+        auto const v = v_min + (v_max - v_min) * i / (bands + 1);
+        edges[i] = std::min(from_scale(scale, v) / bin_width, last_bin);
+    }
+
+    offsets_.reserve(bands + 1);
+    columns_.reserve(bands);
+
+    auto row = std::vector<real_t>();
+    for (std::size_t b = 0; b < bands; b++) {
+        auto const lower  = edges[b];
+        auto const center = edges[b + 1];
+        auto const upper  = edges[b + 2];
+
+        auto const first = static_cast<std::size_t>(std::ceil(lower));
+        auto const last  = static_cast<std::size_t>(std::floor(upper));
+
+        row.clear();
+
+        auto sum = 0.0;
+        if (lower < center && center < upper) {
+            for (std::size_t k = first; k <= last; k++) {
+                auto const w = k <= center
+                        ? std::max((k - lower) / (center - lower), 0.0)
+                        : std::max((upper - k) / (upper - center), 0.0);
+                row.push_back(static_cast<real_t>(w));
+                sum += w;
+            }
+        }
+
+        // a single bin inside the triangle would snap the band to that bin, interpolate instead
+        auto const nonzeros = std::count_if(row.begin(), row.end(), [](real_t w) { return w != real_t{0}; });
+
+        auto column = first;
+        if (sum > 0.0 && nonzeros > 1) {
+            // skip zero weights at the edges
+            while (!row.empty() && row.back() == real_t{0})
+                row.pop_back();
+
+            auto const leading = std::find_if(row.begin(), row.end(), [](real_t w) { return w != real_t{0}; });
+            column += static_cast<std::size_t>(leading - row.begin());
+            row.erase(row.begin(), leading);
+
+            for (auto& w : row)
+                w = static_cast<real_t>(w / sum);
+        } else {
+            // narrow filter: linear interpolation at the center
+            column = std::min(static_cast<std::size_t>(center), input_size_ - 2);
+            auto const t = center - column;
+
+            row = { static_cast<real_t>(1.0 - t), static_cast<real_t>(t) };
+        }
+
+        columns_.push_back(static_cast<std::uint32_t>(column));
+        weights_.insert(weights_.end(), row.begin(), row.end());
+        offsets_.push_back(static_cast<std::uint32_t>(weights_.size()));
+    }
+}
+
+template <class real_t>
+auto filterbank<real_t>::to_scale(frequency_scale scale, double f) -> double {
+    switch (scale) {
+    case frequency_scale::mel:  return 2595.0 * std::log10(1.0 + f / 700.0);
+    case frequency_scale::log:  return std::log(f);
+    default:                    return f;
+    }
+}
+
+template <class real_t>
+auto filterbank<real_t>::from_scale(frequency_scale scale, double v) -> double {
+    switch (scale) {
+    case frequency_scale::mel:  return 700.0 * (std::pow(10.0, v / 2595.0) - 1.0);
+    case frequency_scale::log:  return std::exp(v);
+    default:                    return v;
+    }
+}
+
+template <class real_t>
+auto filterbank<real_t>::input_size() const noexcept -> std::size_t {
+    return input_size_;
+}
+
+template <class real_t>
+auto filterbank<real_t>::output_size() const noexcept -> std::size_t {
+    return columns_.size();
+}
+
+template <class real_t>
+auto filterbank<real_t>::nonzeros() const noexcept -> std::size_t {
+    return weights_.size();
+}
+
+template <class real_t>
+void filterbank<real_t>::apply(real_t const* src, real_t* dst) const {
+    static auto const fn = filterbank_kernels::select_apply<real_t>();
+    fn(src, dst, offsets_.data(), columns_.data(), weights_.data(), columns_.size());
+}
+
+} /* namespace audio */
+} /* namespace avis */
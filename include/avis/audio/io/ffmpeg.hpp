@@ -6,6 +6,9 @@ extern "C" {
 #include <libswresample/swresample.h>
 }
 
+#include <avis/utils/scope_exit.hpp>
+#include <avis/utils/span.hpp>
+
 #include <algorithm>
 #include <string>
 #include <vector>
@@ -164,22 +167,6 @@ auto make_handle(T hndl, DestructorFn&& destructor) -> handle<T, DestructorFn> {
     return {hndl, std::forward<DestructorFn>(destructor)};
 }
 
-
-template <class Fn>
-class on_scope_exit_impl {
-public:
-    on_scope_exit_impl(Fn&& fn) : fn_{std::forward<Fn>(fn)} {}
-    ~on_scope_exit_impl() { fn_(); }
-
-private:
-    Fn fn_;
-};
-
-template <class Fn>
-auto on_scope_exit(Fn&& fn) -> on_scope_exit_impl<Fn> {
-    return std::forward<Fn>(fn);
-}
-
 } /* namespace detail */
 
 
@@ -230,6 +217,9 @@ class audio_input_stream {
 public:
     static inline auto open_default(stream_format const& format, std::string const& filename) -> audio_input_stream;
 
+    // as open_default, but keeps the channel layout of the audio stream, converting only sample format and rate
+    static inline auto open_native(stream_format const& format, std::string const& filename) -> audio_input_stream;
+
     audio_input_stream()
             : output_format_{}
             , input_format_{}
@@ -238,9 +228,9 @@ public:
             , codec_{nullptr}
             , swr_ctx_{nullptr}
             , frame_{nullptr}
-            , buffer_{}
-            , buffer_offset_{0}
-            , eof_{false} {}
+            , eof_{false}
+            , position_{0}
+            , resync_{false} {}
 
     audio_input_stream(AVFormatContext* format_ctx, AVCodecContext* codec_ctx, AVCodec* codec, stream_format const& format)
             : output_format_{format}
@@ -250,9 +240,9 @@ public:
             , codec_{codec}
             , swr_ctx_{nullptr}
             , frame_{av_frame_alloc()}
-            , buffer_{}
-            , buffer_offset_{0}
             , eof_{false}
+            , position_{0}
+            , resync_{false}
             { if (frame_ == nullptr) throw exception(AVERROR(ENOMEM)); }
 
     audio_input_stream(audio_input_stream const& other) = delete;
@@ -265,9 +255,9 @@ public:
             , codec_{std::exchange(other.codec_, nullptr)}
             , swr_ctx_{std::exchange(other.swr_ctx_, nullptr)}
             , frame_{std::exchange(other.frame_, nullptr)}
-            , buffer_{std::move(other.buffer_)}
-            , buffer_offset_{other.buffer_offset_}
-            , eof_{other.eof_} {}
+            , eof_{other.eof_}
+            , position_{other.position_}
+            , resync_{other.resync_} {}
 
     ~audio_input_stream() { close(); }
 
@@ -278,8 +268,22 @@ public:
     inline void close();
 
     inline auto read(unsigned char* buffer, int) -> int;
+
+    // convert into the first region, then into the second one (e.g. the free regions of a ring buffer), returns the
+    // number of samples written, samples not fitting are kept by the resampler for the next call
+    inline auto read_into(utils::span<std::uint8_t> first, utils::span<std::uint8_t> second) -> int;
     inline auto eof() const noexcept -> bool;
 
+    // seek to the given sample (in output samples from the start of the stream) or the closest seek point before
+    // it, position() reflects the actual position once the first frame has been decoded by read()
+    inline void seek(std::int64_t sample);
+
+    // index of the next sample returned by read(), in output samples from the start of the stream
+    inline auto position() const noexcept -> std::int64_t;
+
+    // duration as reported by the container in output samples, -1 if unknown
+    inline auto duration() const noexcept -> std::int64_t;
+
     inline auto play()  const noexcept -> int;
     inline auto pause() const noexcept -> int;
 
@@ -290,6 +294,9 @@ public:
     inline auto get_av_codec()          const noexcept -> AVCodec*;
 
 private:
+    // output sample of the given frame timestamp
+    inline auto get_frame_position(std::int64_t pts) const noexcept -> std::int64_t;
+
     stream_format        output_format_;
     stream_format        input_format_;
 
@@ -299,9 +306,9 @@ private:
 
     SwrContext*          swr_ctx_;
     AVFrame*             frame_;
-    std::vector<uint8_t> buffer_;
-    std::size_t          buffer_offset_;
     bool                 eof_;
+    std::int64_t         position_;
+    bool                 resync_;       // position_ is taken from the next decoded frame
 };
 
 
@@ -331,6 +338,25 @@ auto audio_input_stream::open_default(stream_format const& format, std::string c
     return {format_ctx.release(), codec_ctx.release(), codec, format};
 }
 
+auto audio_input_stream::open_native(stream_format const& format, std::string const& filename) -> audio_input_stream {
+    auto stream = open_default(format, filename);
+
+    int channels = stream.codec_ctx_->channels;
+    std::int64_t channel_layout = stream.codec_ctx_->channel_layout;
+
+    if (channels == 0 && channel_layout != 0)
+        channels = av_get_channel_layout_nb_channels(channel_layout);
+    else if (channels != 0 && channel_layout == 0)
+        channel_layout = av_get_default_channel_layout(channels);
+
+    if (channels == 0)
+        throw exception(AVERROR_INVALIDDATA);
+
+    stream.output_format_.channels       = channels;
+    stream.output_format_.channel_layout = channel_layout;
+    return stream;
+}
+
 auto audio_input_stream::operator=(audio_input_stream&& rhs) -> audio_input_stream& {
     close();
 
@@ -341,9 +367,9 @@ auto audio_input_stream::operator=(audio_input_stream&& rhs) -> audio_input_stre
     codec_         = std::exchange(rhs.codec_, nullptr);
     swr_ctx_       = std::exchange(rhs.swr_ctx_, nullptr);
     frame_         = std::exchange(rhs.frame_, nullptr);
-    buffer_        = std::move(rhs.buffer_);
-    buffer_offset_ = rhs.buffer_offset_;
     eof_           = rhs.eof_;
+    position_      = rhs.position_;
+    resync_        = rhs.resync_;
 
     return *this;
 }
@@ -362,44 +388,64 @@ void audio_input_stream::close() {
         av_frame_free(&frame_);
 
     codec_ = nullptr;
-    buffer_ = {};
 }
 
 auto audio_input_stream::read(std::uint8_t* buffer, int samples) -> int {
+    auto const output_sample_size = get_pcm_sample_size(output_format_);
+    return read_into({buffer, static_cast<std::size_t>(samples * output_sample_size)}, {});
+}
+
+auto audio_input_stream::read_into(utils::span<std::uint8_t> first, utils::span<std::uint8_t> second) -> int {
     std::int64_t const output_sample_size = get_pcm_sample_size(output_format_);
 
+    // output regions, filled in order, the resampler writes directly into them
+    std::uint8_t* out[2] = { first.data(), second.data() };
+    int space[2] = {
+        static_cast<int>(first.size()  / output_sample_size),
+        static_cast<int>(second.size() / output_sample_size),
+    };
+
+    int region = space[0] > 0 ? 0 : 1;
     int read = 0;
 
-    // if samples are bufferd, get them
-    if (buffer_offset_ < buffer_.size()) {
-        int const num_buffered_samples = (buffer_.size() - buffer_offset_) / output_sample_size;
-        int const num_transfer_samples = std::min(num_buffered_samples, samples);
-        auto const num_transfer_bytes = num_transfer_samples * output_sample_size;
+    auto const advance = [&](int len) {
+        out[region]   += len * output_sample_size;
+        space[region] -= len;
+        read          += len;
 
-        auto const copy_start = buffer_.begin() + buffer_offset_;
-        auto const copy_end   = buffer_.begin() + buffer_offset_ + num_transfer_bytes;
+        if (space[region] == 0 && region == 0)
+            region = 1;
+    };
 
-        std::copy(copy_start, copy_end, buffer);
-        buffer_offset_ += num_transfer_bytes;
+    // fetch the samples buffered by the resampler: output which did not fit into the regions of the previous call
+    // (or the first region of this call), a non-null input of zero samples does not flush the resampler (one
+    // pointer per plane, for up to the maximum number of channels supported by swresample)
+    auto const drain = [&]() {
+        std::uint8_t const* none[64] = {};
 
-        if (samples == num_transfer_samples)
-            return samples;
+        while (space[region] > 0) {
+            int const len = except(swr_convert(swr_ctx_, &out[region], space[region], none, 0));
+            if (len == 0)
+                break;
 
-        buffer += num_transfer_bytes;
-        read   += num_transfer_samples;
-    }
+            advance(len);
+        }
+    };
+
+    if (swr_ctx_ != nullptr)
+        drain();
 
     // read, decode and convert next packet
     auto packet = AVPacket{};
     av_init_packet(&packet);
 
-    while (read < samples && !eof_) {
+    while (space[region] > 0 && !eof_) {
         // try to get next frame from decoder
         int err = avcodec_receive_frame(codec_ctx_, frame_);
 
         // if no frame received, send next package to decoder
         if (err == AVERROR(EAGAIN)) {
-            auto packet_guard = detail::on_scope_exit([&](){ av_packet_unref(&packet); });
+            auto packet_guard = utils::on_scope_exit([&](){ av_packet_unref(&packet); });
 
             int err = av_read_frame(format_ctx_, &packet);
             if (err == AVERROR_EOF) {
@@ -414,10 +460,9 @@ auto audio_input_stream::read(std::uint8_t* buffer, int samples) -> int {
 
         // if decoder signals EOF, decoder has been flushed, try to flush converter now
         } else if (err == AVERROR_EOF) {
-            int len = swr_convert(swr_ctx_, &buffer, samples - read, nullptr, 0);
+            int len = swr_convert(swr_ctx_, &out[region], space[region], nullptr, 0);
             if (len > 0) {
-                read   += len;
-                buffer += len * output_sample_size;
+                advance(len);
             } else if (len == 0 || len == AVERROR_EOF) {
                 eof_ = true;
             } else throw exception(len);
@@ -430,7 +475,16 @@ auto audio_input_stream::read(std::uint8_t* buffer, int samples) -> int {
         } else {
             auto new_input_format = make_stream_format(*frame_);
 
-            // re-create resample-context if input format has changed
+            // first frame after seeking, nothing has been read in this call yet
+            if (resync_) {
+                if (frame_->pts != AV_NOPTS_VALUE)
+                    position_ = get_frame_position(frame_->pts);
+
+                resync_ = false;
+            }
+
+            // re-create resample-context if input format has changed, nothing is buffered at this point as the
+            // current region has not been filled by draining
             if (input_format_ != new_input_format) {
                 swr_ctx_ = swr_alloc_set_opts(swr_ctx_,
                         output_format_.channel_layout, output_format_.sample_format, output_format_.sample_rate,
@@ -443,35 +497,14 @@ auto audio_input_stream::read(std::uint8_t* buffer, int samples) -> int {
 
             auto in_ptr = const_cast<const uint8_t**>(frame_->extended_data);
 
-            // if dst-buffer has enough space, copy directly
-            auto out_samples = swr_get_out_samples(swr_ctx_, frame_->nb_samples);
-            if (out_samples <= samples - read) {
-                int const len = except(swr_convert(swr_ctx_, &buffer, samples - read, in_ptr, frame_->nb_samples));
-                read   += len;
-                buffer += len * output_sample_size;
-
-            // else copy to intermediate-buffer, return as much as possible
-            } else {
-                // convert and store in intermediate buffer
-                buffer_.resize(out_samples * output_sample_size);
-                auto out_ptr = buffer_.data();
-                int const len = except(swr_convert(swr_ctx_, &out_ptr, out_samples, in_ptr, frame_->nb_samples));
-                buffer_.resize(len * output_sample_size);
-
-                // (partial) copy to output-buffer
-                int const num_transfer_samples = std::min(len, samples - read);
-                auto const num_transfer_bytes = num_transfer_samples * output_sample_size;
-
-                std::copy(buffer_.begin(), buffer_.begin() + num_transfer_bytes, buffer);
-
-                read   += num_transfer_samples;
-                buffer += num_transfer_bytes;
-
-                buffer_offset_ = num_transfer_bytes;
-            }
+            // convert into the current region, the resampler buffers what does not fit, continue with the next one
+            int const len = except(swr_convert(swr_ctx_, &out[region], space[region], in_ptr, frame_->nb_samples));
+            advance(len);
+            drain();
         }
     }
 
+    position_ += read;
     return read;
 }
 
@@ -479,6 +512,47 @@ auto audio_input_stream::eof() const noexcept -> bool {
     return eof_;
 }
 
+void audio_input_stream::seek(std::int64_t sample) {
+    auto const time_base = AVRational{1, AV_TIME_BASE};
+
+    auto timestamp = av_rescale_q(sample, AVRational{1, output_format_.sample_rate}, time_base);
+    if (format_ctx_->start_time != AV_NOPTS_VALUE)
+        timestamp += format_ctx_->start_time;
+
+    except(av_seek_frame(format_ctx_, -1, timestamp, AVSEEK_FLAG_BACKWARD));
+    avcodec_flush_buffers(codec_ctx_);
+
+    // drop everything buffered for the previous position, the resampler is re-created with the next frame
+    if (swr_ctx_ != nullptr)
+        swr_free(&swr_ctx_);
+
+    input_format_  = {};
+    eof_           = false;
+    position_      = sample;
+    resync_        = true;
+}
+
+auto audio_input_stream::position() const noexcept -> std::int64_t {
+    return position_;
+}
+
+auto audio_input_stream::duration() const noexcept -> std::int64_t {
+    if (format_ctx_ == nullptr || format_ctx_->duration == AV_NOPTS_VALUE)
+        return -1;
+
+    return av_rescale_q(format_ctx_->duration, AVRational{1, AV_TIME_BASE},
+            AVRational{1, output_format_.sample_rate});
+}
+
+auto audio_input_stream::get_frame_position(std::int64_t pts) const noexcept -> std::int64_t {
+    auto const time_base = av_codec_get_pkt_timebase(codec_ctx_);
+
+    if (format_ctx_->start_time != AV_NOPTS_VALUE)
+        pts -= av_rescale_q(format_ctx_->start_time, AVRational{1, AV_TIME_BASE}, time_base);
+
+    return av_rescale_q(pts, time_base, AVRational{1, output_format_.sample_rate});
+}
+
 auto audio_input_stream::play() const noexcept -> int {
     return av_read_play(format_ctx_);
 }
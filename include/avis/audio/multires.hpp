@@ -0,0 +1,395 @@
+#pragma once
+
+#include <avis/audio/fft.hpp>
+#include <avis/audio/fft/kernels.hpp>
+#include <avis/utils/aligned_buffer.hpp>
+#include <avis/utils/constexpr_math.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+
+namespace avis {
+namespace audio {
+
+namespace halfband_kernels {
+
+// Polyphase halfband decimation: dst[j] = center odd[j] + sum_i coefficients[i] (even[j + 1 + i] + even[j - i]),
+// with even and odd pointing to the phases aligned to the center of the filter.
+template <class real_t>
+using decimate_fn = void (*)(real_t const* even, real_t const* odd, real_t* dst, std::size_t count,
+        real_t const* coefficients, std::size_t m, real_t center);
+
+template <class real_t>
+inline void decimate_scalar(real_t const* even, real_t const* odd, real_t* dst, std::size_t count,
+        real_t const* coefficients, std::size_t m, real_t center)
+{
+    for (std::size_t j = 0; j < count; j++) {
+        auto acc = center * odd[j];
+        for (std::size_t i = 0; i < m; i++)
+            acc += coefficients[i] * (even[j + 1 + i] + even[j - i]);
+
+        dst[j] = acc;
+    }
+}
+
+
+#ifdef AVIS_AUDIO_FFT_X86_KERNELS
+
+__attribute__((target("avx2,fma")))
+inline void decimate_avx2(float const* even, float const* odd, float* dst, std::size_t count,
+        float const* coefficients, std::size_t m, float center)
+{
+    auto const c0 = _mm256_set1_ps(center);
+
+    // two vectors of outputs per iteration, the coefficient loop is shared
+    std::size_t j = 0;
+    for (; j + 16 <= count; j += 16) {
+        auto acc0 = _mm256_mul_ps(c0, _mm256_loadu_ps(odd + j));
+        auto acc1 = _mm256_mul_ps(c0, _mm256_loadu_ps(odd + j + 8));
+
+        for (std::size_t i = 0; i < m; i++) {
+            auto const c     = _mm256_set1_ps(coefficients[i]);
+            auto const upper = even + j + 1 + i;
+            auto const lower = even + j - i;
+
+            acc0 = _mm256_fmadd_ps(c, _mm256_add_ps(_mm256_loadu_ps(upper),     _mm256_loadu_ps(lower)),     acc0);
+            acc1 = _mm256_fmadd_ps(c, _mm256_add_ps(_mm256_loadu_ps(upper + 8), _mm256_loadu_ps(lower + 8)), acc1);
+        }
+
+        _mm256_storeu_ps(dst + j,     acc0);
+        _mm256_storeu_ps(dst + j + 8, acc1);
+    }
+
+    decimate_scalar(even + j, odd + j, dst + j, count - j, coefficients, m, center);
+}
+
+__attribute__((target("avx512f")))
+inline void decimate_avx512(float const* even, float const* odd, float* dst, std::size_t count,
+        float const* coefficients, std::size_t m, float center)
+{
+    auto const c0 = _mm512_set1_ps(center);
+
+    std::size_t j = 0;
+    for (; j + 32 <= count; j += 32) {
+        auto acc0 = _mm512_mul_ps(c0, _mm512_loadu_ps(odd + j));
+        auto acc1 = _mm512_mul_ps(c0, _mm512_loadu_ps(odd + j + 16));
+
+        for (std::size_t i = 0; i < m; i++) {
+            auto const c     = _mm512_set1_ps(coefficients[i]);
+            auto const upper = even + j + 1 + i;
+            auto const lower = even + j - i;
+
+            acc0 = _mm512_fmadd_ps(c, _mm512_add_ps(_mm512_loadu_ps(upper),      _mm512_loadu_ps(lower)),      acc0);
+            acc1 = _mm512_fmadd_ps(c, _mm512_add_ps(_mm512_loadu_ps(upper + 16), _mm512_loadu_ps(lower + 16)), acc1);
+        }
+
+        _mm512_storeu_ps(dst + j,      acc0);
+        _mm512_storeu_ps(dst + j + 16, acc1);
+    }
+
+    // remainder using masked loads and stores
+    for (; j < count; j += 16) {
+        auto const mask = static_cast<__mmask16>(count - j >= 16 ? 0xffff : (1u << (count - j)) - 1);
+
+        auto acc = _mm512_mul_ps(c0, _mm512_maskz_loadu_ps(mask, odd + j));
+        for (std::size_t i = 0; i < m; i++) {
+            auto const c     = _mm512_set1_ps(coefficients[i]);
+            auto const upper = _mm512_maskz_loadu_ps(mask, even + j + 1 + i);
+            auto const lower = _mm512_maskz_loadu_ps(mask, even + j - i);
+
+            acc = _mm512_fmadd_ps(c, _mm512_add_ps(upper, lower), acc);
+        }
+
+        _mm512_mask_storeu_ps(dst + j, mask, acc);
+    }
+}
+
+#endif /* AVIS_AUDIO_FFT_X86_KERNELS */
+
+template <class real_t>
+inline auto select_decimate() noexcept -> decimate_fn<real_t> {
+    return decimate_scalar<real_t>;
+}
+
+template <>
+inline auto select_decimate<float>() noexcept -> decimate_fn<float> {
+    switch (fft::get_kernel_isa()) {
+#ifdef AVIS_AUDIO_FFT_X86_KERNELS
+    case fft::kernel_isa::avx512:   return decimate_avx512;
+    case fft::kernel_isa::avx2:     return decimate_avx2;
+#endif
+    default:                        return decimate_scalar<float>;
+    }
+}
+
+} /* namespace halfband_kernels */
+
+
+// Halfband lowpass for decimation by two: windowed sinc (Blackman) with the cutoff at a quarter of the input rate,
+// every other coefficient apart from the center is zero. Passband up to 0.2, stopband from 0.3 of the input rate
+// (about 70 dB attenuation), i.e. after decimation the range up to 0.8 of the output Nyquist frequency is free of
+// aliasing. The filter is evaluated in polyphase form: the center coefficient applies to the odd, all other
+// non-zero coefficients to the even input samples, both phases are contiguous along the outputs.
+template <class real_t = float>
+class halfband_filter {
+public:
+    static constexpr std::size_t taps = 59;
+
+    inline halfband_filter();
+
+    // output j is computed from the inputs 2j to 2j + taps - 1, src must provide 2 (count - 1) + taps samples
+    template <class InputIterator>
+    void decimate(InputIterator src, real_t* dst, std::size_t count);
+
+private:
+    static_assert(taps % 4 == 3, "The halfband filter requires an odd center index!");
+
+    static constexpr std::size_t center = (taps - 1) / 2;
+
+    real_t              center_coefficient_;
+    std::vector<real_t> coefficients_;      // non-zero coefficients at odd distances 1, 3, 5, ... from the center
+    std::vector<real_t> even_;
+    std::vector<real_t> odd_;
+};
+
+
+template <class real_t>
+constexpr std::size_t halfband_filter<real_t>::taps;
+
+template <class real_t>
+constexpr std::size_t halfband_filter<real_t>::center;
+
+template <class real_t>
+halfband_filter<real_t>::halfband_filter()
+        : center_coefficient_{0}
+        , coefficients_{}
+        , even_{}
+        , odd_{}
+{
+    auto h = std::vector<double>(taps);
+    auto sum = 0.0;
+
+    for (std::size_t i = 0; i < taps; i++) {
+        auto const d = static_cast<double>(i) - static_cast<double>(center);
+        auto const x = math::pi<double> * d / 2.0;
+        auto const w = 0.42 - 0.5 * std::cos(2.0 * math::pi<double> * i / (taps - 1))
+                + 0.08 * std::cos(4.0 * math::pi<double> * i / (taps - 1));
+
+        h[i] = (d == 0.0 ? 1.0 : std::sin(x) / x) * w;
+        sum += h[i];
+    }
+
+    // unit gain at DC
+    center_coefficient_ = static_cast<real_t>(h[center] / sum);
+    for (std::size_t d = 1; d <= center; d += 2)
+        coefficients_.push_back(static_cast<real_t>(h[center + d] / sum));
+}
+
+template <class real_t>
+template <class InputIterator>
+void halfband_filter<real_t>::decimate(InputIterator src, real_t* dst, std::size_t count) {
+    auto const m      = coefficients_.size();
+    auto const inputs = 2 * (count - 1) + taps;
+
+    // split into the even and odd input samples, the number of inputs is odd
+    even_.resize(inputs / 2 + 1);
+    odd_.resize(inputs / 2);
+
+    for (std::size_t i = 0; i < odd_.size(); i++) {
+        even_[i] = *(src++);
+        odd_[i]  = *(src++);
+    }
+    even_.back() = *src;
+
+    // x[2j + center] is odd[j + center / 2], x[2j + center +- (2i + 1)] are even[j + center / 2 + 1 + i] and
+    // even[j + center / 2 - i]
+    static auto const fn = halfband_kernels::select_decimate<real_t>();
+    fn(even_.data() + center / 2, odd_.data() + center / 2, dst, count, coefficients_.data(), m,
+            center_coefficient_);
+}
+
+
+// Multi-resolution spectrogram: n-point FFTs over successively decimated versions of the input, each level
+// halving the sample rate and thus doubling the window length and frequency resolution. Each level contributes the
+// octave [0.4, 0.8] of its Nyquist frequency, the undecimated level everything above and the last level everything
+// below, stitched into one row of magnitudes with ascending frequency (the last level first). The windows of all
+// levels are centered in the input frame, the frame covers the window of the last level plus the support of the
+// decimation filters. Each level is decimated from the central samples required by the following levels only, a
+// row costs one n-point FFT per level and about 2^(levels - 1) n halfband outputs in total. Magnitudes keep the
+// scale of fft_plan.
+template <class real_t = float>
+class multires_plan {
+public:
+    multires_plan()
+            : size_{0}
+            , levels_{0}
+            , band_{0}
+            , filter_{}
+            , plan_{}
+            , frame_sizes_{}
+            , buffer_a_{}
+            , buffer_b_{}
+            , buffer_row_{} {}
+
+    inline multires_plan(std::size_t n, std::size_t levels);
+
+    inline auto size()        const noexcept -> std::size_t;
+    inline auto levels()      const noexcept -> std::size_t;
+    inline auto input_size()  const noexcept -> std::size_t;
+    inline auto output_size() const noexcept -> std::size_t;
+
+    // first output index and number of outputs of the given level
+    inline auto level_offset(std::size_t level) const noexcept -> std::size_t;
+    inline auto level_size(std::size_t level)   const noexcept -> std::size_t;
+
+    inline auto get_magnitude_mode() const noexcept -> magnitude_mode;
+    inline void set_magnitude_mode(magnitude_mode mode) noexcept;
+
+    // dst must be a random-access iterator
+    template <class InputIterator, class OutputIterator>
+    void execute(InputIterator src, OutputIterator dst);
+
+    template <class InputIterator, class OutputIterator>
+    void execute_batch(InputIterator src, OutputIterator dst, std::size_t count, std::ptrdiff_t stride,
+            std::size_t hop);
+
+private:
+    // first bin used of the given level
+    inline auto level_bin(std::size_t level) const noexcept -> std::size_t;
+
+    std::size_t                   size_;
+    std::size_t                   levels_;
+    std::size_t                   band_;            // bins per octave band, i.e. the bin at 0.4 Nyquist
+    halfband_filter<real_t>       filter_;
+    dynamic_fft_plan<real_t>      plan_;
+    std::vector<std::size_t>      frame_sizes_;     // samples required per level
+    utils::aligned_buffer<real_t> buffer_a_;
+    utils::aligned_buffer<real_t> buffer_b_;
+    utils::aligned_buffer<real_t> buffer_row_;
+};
+
+
+template <class real_t>
+multires_plan<real_t>::multires_plan(std::size_t n, std::size_t levels)
+        : size_{n}
+        , levels_{levels}
+        , band_{n / 5}
+        , filter_{}
+        , plan_{n}
+        , frame_sizes_(levels)
+        , buffer_a_{}
+        , buffer_b_{}
+        , buffer_row_{rfft_output_size(n)}
+{
+    if (levels == 0)
+        throw std::invalid_argument("The multi-resolution plan requires at least one level!");
+
+    if (n < 10)
+        throw std::invalid_argument("The multi-resolution plan requires N to be at least ten!");
+
+    // each level is decimated from the central samples of the previous one
+    frame_sizes_[levels - 1] = n;
+    for (std::size_t l = levels - 1; l > 0; l--)
+        frame_sizes_[l - 1] = std::max(n, 2 * frame_sizes_[l] + halfband_filter<real_t>::taps - 2);
+
+    auto const buffer_size = levels > 1 ? frame_sizes_[1] : 0;
+    buffer_a_ = utils::aligned_buffer<real_t>{buffer_size};
+    buffer_b_ = utils::aligned_buffer<real_t>{buffer_size};
+}
+
+template <class real_t>
+auto multires_plan<real_t>::size() const noexcept -> std::size_t {
+    return size_;
+}
+
+template <class real_t>
+auto multires_plan<real_t>::levels() const noexcept -> std::size_t {
+    return levels_;
+}
+
+template <class real_t>
+auto multires_plan<real_t>::input_size() const noexcept -> std::size_t {
+    return frame_sizes_.empty() ? 0 : frame_sizes_[0];
+}
+
+template <class real_t>
+auto multires_plan<real_t>::output_size() const noexcept -> std::size_t {
+    return levels_ == 0 ? 0 : level_offset(0) + level_size(0);
+}
+
+template <class real_t>
+auto multires_plan<real_t>::level_bin(std::size_t level) const noexcept -> std::size_t {
+    return level + 1 < levels_ ? band_ : 0;
+}
+
+template <class real_t>
+auto multires_plan<real_t>::level_size(std::size_t level) const noexcept -> std::size_t {
+    auto const last = level == 0 ? rfft_output_size(size_) : 2 * band_;
+    return last - level_bin(level);
+}
+
+template <class real_t>
+auto multires_plan<real_t>::level_offset(std::size_t level) const noexcept -> std::size_t {
+    // the last level comes first, followed by one octave band per level
+    return level + 1 < levels_ ? 2 * band_ + (levels_ - 2 - level) * band_ : 0;
+}
+
+template <class real_t>
+auto multires_plan<real_t>::get_magnitude_mode() const noexcept -> magnitude_mode {
+    return plan_.get_magnitude_mode();
+}
+
+template <class real_t>
+void multires_plan<real_t>::set_magnitude_mode(magnitude_mode mode) noexcept {
+    plan_.set_magnitude_mode(mode);
+}
+
+template <class real_t>
+template <class InputIterator, class OutputIterator>
+void multires_plan<real_t>::execute(InputIterator src, OutputIterator dst) {
+    auto const row = buffer_row_.data();
+
+    auto const store = [&](std::size_t level) {
+        auto const first = row + level_bin(level);
+        std::copy(first, first + level_size(level), std::next(dst, level_offset(level)));
+    };
+
+    // undecimated level: central n samples of the frame
+    plan_.execute(std::next(src, (frame_sizes_[0] - size_) / 2), row);
+    store(0);
+
+    if (levels_ == 1)
+        return;
+
+    // the first level is decimated directly from the input, all others from the previous level
+    auto in  = buffer_b_.data();
+    auto out = buffer_a_.data();
+
+    for (std::size_t l = 1; l < levels_; l++) {
+        if (l == 1)
+            filter_.decimate(src, out, frame_sizes_[l]);
+        else
+            filter_.decimate(static_cast<real_t const*>(in), out, frame_sizes_[l]);
+
+        plan_.execute(out + (frame_sizes_[l] - size_) / 2, row);
+        store(l);
+
+        std::swap(in, out);
+    }
+}
+
+template <class real_t>
+template <class InputIterator, class OutputIterator>
+void multires_plan<real_t>::execute_batch(InputIterator src, OutputIterator dst, std::size_t count,
+        std::ptrdiff_t stride, std::size_t hop)
+{
+    for (std::size_t i = 0; i < count; i++)
+        execute(std::next(src, hop * i), std::next(dst, stride * i));
+}
+
+} /* namespace audio */
+} /* namespace avis */
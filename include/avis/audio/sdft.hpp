@@ -0,0 +1,258 @@
+#pragma once
+
+#include <avis/audio/fft.hpp>
+#include <avis/utils/constexpr_math.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+
+namespace avis {
+namespace audio {
+
+// Sliding DFT over the last n samples for a subset of the bins of an n-point real FFT. Each new sample updates the
+// tracked bins in O(bins) using the recursion S_k = r W_n^-k (S_k + x[t] - r^n x[t-n]), where the damping factor r
+// slightly below one keeps the accumulated rounding errors from growing unbounded. The Hann window is applied in
+// the frequency domain, X_w[k] = 0.5 X[k] - 0.25 (X[k-1] + X[k+1]), thus the direct neighbours of each requested
+// bin are tracked as well. Note that this is the periodic Hann window 0.5 - 0.5 cos(2 pi i / n), whereas fft_plan
+// applies the symmetric one with n - 1 in the denominator, which has no three-term form in the frequency domain.
+// Together with the damping (the window decays by r^n towards the oldest sample, 0.18 dB on average for n = 4096)
+// this is compensated in the scale, such that sinusoids have the same level as in fft_plan, only the main lobe is
+// marginally narrower. Rows are written in the same format as fft_plan: n/2 + 1 magnitudes, with all bins not
+// requested set to zero. The same magnitude modes as for fft_plan are supported.
+template <class real_t = float>
+class sliding_dft {
+public:
+    using complex_type = std::complex<real_t>;
+
+    static constexpr real_t default_damping = static_cast<real_t>(0.99999);
+
+    sliding_dft()
+            : size_{0}
+            , damping_n_{0}
+            , scale_{0}
+            , bins_{}
+            , outputs_{}
+            , coefficients_{}
+            , state_{}
+            , history_{}
+            , history_pos_{0}
+            , mode_{magnitude_mode::magnitude} {}
+
+    inline sliding_dft(std::size_t n, std::vector<std::size_t> bins, real_t damping = default_damping);
+
+    inline auto size()        const noexcept -> std::size_t;
+    inline auto output_size() const noexcept -> std::size_t;
+    inline auto bins()        const noexcept -> std::vector<std::size_t> const&;
+
+    inline auto get_magnitude_mode() const noexcept -> magnitude_mode;
+    inline void set_magnitude_mode(magnitude_mode mode) noexcept;
+
+    inline void reset();
+    inline void update(real_t sample);
+
+    template <class OutputIterator>
+    void write(OutputIterator dst) const;
+
+    template <class InputIterator, class OutputIterator>
+    void execute_batch(InputIterator src, OutputIterator dst, std::size_t count, std::ptrdiff_t stride,
+            std::size_t hop);
+
+private:
+    // a neighbour outside of [0, n/2] is the complex conjugate of its mirrored bin (real input)
+    struct term {
+        std::size_t index;
+        bool        conjugate;
+    };
+
+    struct output {
+        std::size_t bin;
+        term        center;
+        term        lower;
+        term        upper;
+    };
+
+    inline auto value(term const& t) const noexcept -> complex_type;
+    inline auto norm(complex_type const& x) const noexcept -> real_t;
+
+    std::size_t               size_;
+    real_t                    damping_n_;
+    real_t                    scale_;
+    std::vector<std::size_t>  bins_;
+    std::vector<output>       outputs_;
+    std::vector<complex_type> coefficients_;
+    std::vector<complex_type> state_;
+    std::vector<real_t>       history_;
+    std::size_t               history_pos_;
+    magnitude_mode            mode_;
+};
+
+
+template <class real_t>
+constexpr real_t sliding_dft<real_t>::default_damping;
+
+template <class real_t>
+sliding_dft<real_t>::sliding_dft(std::size_t n, std::vector<std::size_t> bins, real_t damping)
+        : size_{n}
+        , damping_n_{static_cast<real_t>(std::pow(static_cast<double>(damping), static_cast<double>(n)))}
+        , scale_{0}
+        , bins_{std::move(bins)}
+        , outputs_{}
+        , coefficients_{}
+        , state_{}
+        , history_(n)
+        , history_pos_{0}
+        , mode_{magnitude_mode::magnitude}
+{
+    if (n < 4)
+        throw std::invalid_argument("The sliding DFT requires N to be at least four!");
+
+    std::sort(bins_.begin(), bins_.end());
+    bins_.erase(std::unique(bins_.begin(), bins_.end()), bins_.end());
+
+    if (!bins_.empty() && bins_.back() > n / 2)
+        throw std::invalid_argument("Sliding DFT bins must be in [0, N/2]!");
+
+    // the damping weights the sample of age a by r^(a + 1): scale by the sum of the damped periodic window instead
+    // of the sum of the symmetric window of fft_plan ((n - 1) / 2), giving sinusoids the same level as fft_plan
+    auto window_sum = 0.0;
+    for (std::size_t i = 0; i < n; i++) {
+        auto const w = 0.5 * (1.0 - std::cos((2.0 * math::pi<double> * i) / n));
+        window_sum += w * std::pow(static_cast<double>(damping), static_cast<double>(n - i));
+    }
+
+    scale_ = static_cast<real_t>((n - 1.0) / (2.0 * window_sum * std::sqrt(static_cast<double>(n))));
+
+    // collect tracked bins: requested bins and their neighbours, mirrored into [0, n/2]
+    auto const mirror = [n](std::ptrdiff_t k) -> std::size_t {
+        if (k < 0)
+            return static_cast<std::size_t>(-k);
+        if (static_cast<std::size_t>(k) > n / 2)
+            return n - static_cast<std::size_t>(k);
+        return static_cast<std::size_t>(k);
+    };
+
+    auto tracked = std::vector<std::size_t>{};
+    for (auto const k : bins_) {
+        auto const s = static_cast<std::ptrdiff_t>(k);
+        tracked.push_back(mirror(s - 1));
+        tracked.push_back(k);
+        tracked.push_back(mirror(s + 1));
+    }
+
+    std::sort(tracked.begin(), tracked.end());
+    tracked.erase(std::unique(tracked.begin(), tracked.end()), tracked.end());
+
+    auto const make_term = [&](std::ptrdiff_t k) -> term {
+        auto const index = std::lower_bound(tracked.begin(), tracked.end(), mirror(k)) - tracked.begin();
+        return {static_cast<std::size_t>(index), k < 0 || static_cast<std::size_t>(k) > n / 2};
+    };
+
+    for (auto const k : bins_) {
+        auto const s = static_cast<std::ptrdiff_t>(k);
+        outputs_.push_back({k, make_term(s), make_term(s - 1), make_term(s + 1)});
+    }
+
+    // per-bin coefficients r W_n^-k
+    coefficients_.resize(tracked.size());
+    for (std::size_t i = 0; i < tracked.size(); i++) {
+        double const arg = 2.0 * math::pi<double> * tracked[i] / n;
+        coefficients_[i] = std::polar(static_cast<real_t>(damping), static_cast<real_t>(arg));
+    }
+
+    state_.resize(tracked.size());
+}
+
+template <class real_t>
+auto sliding_dft<real_t>::size() const noexcept -> std::size_t {
+    return size_;
+}
+
+template <class real_t>
+auto sliding_dft<real_t>::output_size() const noexcept -> std::size_t {
+    return rfft_output_size(size_);
+}
+
+template <class real_t>
+auto sliding_dft<real_t>::bins() const noexcept -> std::vector<std::size_t> const& {
+    return bins_;
+}
+
+template <class real_t>
+auto sliding_dft<real_t>::get_magnitude_mode() const noexcept -> magnitude_mode {
+    return mode_;
+}
+
+template <class real_t>
+void sliding_dft<real_t>::set_magnitude_mode(magnitude_mode mode) noexcept {
+    mode_ = mode;
+}
+
+template <class real_t>
+void sliding_dft<real_t>::reset() {
+    std::fill(state_.begin(), state_.end(), complex_type{});
+    std::fill(history_.begin(), history_.end(), real_t{0});
+    history_pos_ = 0;
+}
+
+template <class real_t>
+void sliding_dft<real_t>::update(real_t sample) {
+    auto const delta = complex_type{sample - damping_n_ * history_[history_pos_], 0};
+
+    history_[history_pos_] = sample;
+    history_pos_ = history_pos_ + 1 < size_ ? history_pos_ + 1 : 0;
+
+    for (std::size_t i = 0; i < state_.size(); i++)
+        state_[i] = fft::cmul(coefficients_[i], state_[i] + delta);
+}
+
+template <class real_t>
+auto sliding_dft<real_t>::value(term const& t) const noexcept -> complex_type {
+    return t.conjugate ? std::conj(state_[t.index]) : state_[t.index];
+}
+
+template <class real_t>
+auto sliding_dft<real_t>::norm(complex_type const& x) const noexcept -> real_t {
+    switch (mode_) {
+    case magnitude_mode::power:         return fft::norm_power<real_t>{scale_ * scale_}(x);
+    case magnitude_mode::approximate:   return fft::norm_approximate<real_t>{scale_}(x);
+    default:                            return std::abs(x) * scale_;
+    }
+}
+
+// periodic Hann window, see the class comment on how this differs from fft_plan
+template <class real_t>
+template <class OutputIterator>
+void sliding_dft<real_t>::write(OutputIterator dst) const {
+    auto const half    = static_cast<real_t>(0.5);
+    auto const quarter = static_cast<real_t>(0.25);
+
+    std::fill_n(dst, output_size(), real_t{0});
+
+    for (auto const& o : outputs_) {
+        auto const x = value(o.center) * half - (value(o.lower) + value(o.upper)) * quarter;
+        *std::next(dst, o.bin) = norm(x);
+    }
+}
+
+template <class real_t>
+template <class InputIterator, class OutputIterator>
+void sliding_dft<real_t>::execute_batch(InputIterator src, OutputIterator dst, std::size_t count,
+        std::ptrdiff_t stride, std::size_t hop)
+{
+    // consume hop samples per row, output rows start every stride elements in dst
+    for (std::size_t i = 0; i < count; i++) {
+        for (std::size_t j = 0; j < hop; j++)
+            update(*(src++));
+
+        write(std::next(dst, stride * static_cast<std::ptrdiff_t>(i)));
+    }
+}
+
+} /* namespace audio */
+} /* namespace avis */
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <avis/audio/io/ffmpeg.hpp>
+#include <avis/audio/fft.hpp>
+#include <avis/utils/aligned_buffer.hpp>
+#include <avis/utils/thread_pool.hpp>
+
+#include <cinttypes>
+#include <string>
+#include <vector>
+
+
+namespace avis {
+
+// header of the spectrogram files written by offline_renderer, followed by rows * layers * bins magnitudes (32 bit
+// float), the layers of each row follow each other, all values in native byte order
+struct spectrogram_header {
+    char          magic[4];     // "AVSP"
+    std::uint32_t layers;       // channels of the file
+    std::uint32_t bins;         // window / 2 + 1
+    std::uint32_t window;       // samples per analysis window
+    std::uint32_t hop;          // samples between consecutive windows
+    std::uint32_t sample_rate;
+    std::uint64_t rows;
+};
+
+static_assert(sizeof(spectrogram_header) == 32, "Unexpected padding in spectrogram_header!");
+
+
+// Renders a whole file into a spectrogram file, decoding and transforming as fast as the CPU allows, without audio
+// device or window. Long files with known duration are split into one segment per worker, each decoded using its own
+// stream starting at a seek point shortly before the segment (priming decoder and resampler), and continued past its
+// end for the windows spanning the seam. The rows of each segment are written to their final position in the file.
+// Otherwise, the rows of each decoded block are transformed on the worker pool while this thread decodes the next
+// block. Only complete windows are transformed: the samples after the last complete window (less than one window)
+// are dropped, not zero-padded. Both ways produce the same rows, up to the sub-sample offset a resampler may have
+// after seeking.
+class offline_renderer {
+public:
+    struct statistics {
+        std::int64_t frames;        // samples per channel
+        std::int64_t rows;
+        std::int64_t segments;      // decoded in parallel, one if rendered sequentially
+        double       seconds;
+    };
+
+    offline_renderer(audio::ffmpeg::stream_format const& format, std::size_t window, std::size_t hop,
+            std::size_t workers = utils::thread_pool::default_concurrency());
+
+    auto render(std::string const& input, std::string const& output) -> statistics;
+
+private:
+    struct segment_result {
+        std::int64_t rows;
+        std::int64_t end;           // position of the stream after the last read
+        bool         complete;      // all rows of the segment have been written
+    };
+
+    auto make_header(audio::ffmpeg::stream_format const& fmt, std::int64_t rows) const -> spectrogram_header;
+
+    auto render_sequential(std::string const& input, std::string const& output) -> statistics;
+    auto render_segmented(std::string const& input, std::string const& output,
+            audio::ffmpeg::stream_format const& fmt, std::int64_t duration, statistics& stats) -> bool;
+    auto render_segment(std::string const& input, std::string const& output, std::size_t worker,
+            std::int64_t first_row, std::int64_t last_row) -> segment_result;
+
+    audio::ffmpeg::stream_format             format_;
+    std::size_t                              window_;
+    std::size_t                              hop_;
+    utils::thread_pool                       workers_;
+    std::vector<audio::dynamic_fft_plan<float>> plans_;    // one plan per worker
+    std::vector<std::uint8_t>                readbuf_;
+    std::vector<std::vector<float>>          planes_;      // one per channel
+    utils::aligned_buffer<float>             rows_;
+};
+
+} /* namespace avis */
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <algorithm>
+#include <cinttypes>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+
+namespace avis {
+namespace utils {
+
+constexpr std::size_t cache_line_size = 64;
+
+
+template <class T>
+class aligned_buffer {
+    static_assert(std::is_trivially_copyable<T>::value && std::is_trivially_destructible<T>::value,
+            "aligned_buffer requires a trivially copyable and destructible value type!");
+
+public:
+    using value_type = T;
+
+    aligned_buffer()
+            : storage_{}
+            , data_{nullptr}
+            , size_{0} {}
+
+    explicit aligned_buffer(std::size_t size)
+            : storage_{new std::uint8_t[size * sizeof(T) + cache_line_size]}
+            , data_{align(storage_.get())}
+            , size_{size}
+            { std::uninitialized_fill(data_, data_ + size_, T{}); }
+
+    aligned_buffer(aligned_buffer const& other)
+            : aligned_buffer(other.size_)
+            { std::copy(other.data_, other.data_ + other.size_, data_); }
+
+    aligned_buffer(aligned_buffer&& other)
+            : storage_{std::move(other.storage_)}
+            , data_{std::exchange(other.data_, nullptr)}
+            , size_{std::exchange(other.size_, 0)} {}
+
+    inline auto operator= (aligned_buffer const& rhs) -> aligned_buffer&;
+    inline auto operator= (aligned_buffer&& rhs)      -> aligned_buffer&;
+
+    inline auto data()       noexcept -> T*;
+    inline auto data() const noexcept -> T const*;
+    inline auto size() const noexcept -> std::size_t;
+
+    inline auto begin()       noexcept -> T*;
+    inline auto begin() const noexcept -> T const*;
+    inline auto end()         noexcept -> T*;
+    inline auto end()   const noexcept -> T const*;
+
+    inline auto operator[] (std::size_t i)       noexcept -> T&;
+    inline auto operator[] (std::size_t i) const noexcept -> T const&;
+
+private:
+    static inline auto align(std::uint8_t* ptr) noexcept -> T*;
+
+    std::unique_ptr<std::uint8_t[]> storage_;
+    T*                              data_;
+    std::size_t                     size_;
+};
+
+
+template <class T>
+auto aligned_buffer<T>::operator= (aligned_buffer const& rhs) -> aligned_buffer& {
+    if (this != &rhs)
+        *this = aligned_buffer(rhs);
+
+    return *this;
+}
+
+template <class T>
+auto aligned_buffer<T>::operator= (aligned_buffer&& rhs) -> aligned_buffer& {
+    storage_ = std::move(rhs.storage_);
+    data_    = std::exchange(rhs.data_, nullptr);
+    size_    = std::exchange(rhs.size_, 0);
+    return *this;
+}
+
+template <class T>
+auto aligned_buffer<T>::data() noexcept -> T* {
+    return data_;
+}
+
+template <class T>
+auto aligned_buffer<T>::data() const noexcept -> T const* {
+    return data_;
+}
+
+template <class T>
+auto aligned_buffer<T>::size() const noexcept -> std::size_t {
+    return size_;
+}
+
+template <class T>
+auto aligned_buffer<T>::begin() noexcept -> T* {
+    return data_;
+}
+
+template <class T>
+auto aligned_buffer<T>::begin() const noexcept -> T const* {
+    return data_;
+}
+
+template <class T>
+auto aligned_buffer<T>::end() noexcept -> T* {
+    return data_ + size_;
+}
+
+template <class T>
+auto aligned_buffer<T>::end() const noexcept -> T const* {
+    return data_ + size_;
+}
+
+template <class T>
+auto aligned_buffer<T>::operator[] (std::size_t i) noexcept -> T& {
+    return data_[i];
+}
+
+template <class T>
+auto aligned_buffer<T>::operator[] (std::size_t i) const noexcept -> T const& {
+    return data_[i];
+}
+
+template <class T>
+auto aligned_buffer<T>::align(std::uint8_t* ptr) noexcept -> T* {
+    auto const addr = reinterpret_cast<std::uintptr_t>(ptr);
+    auto const offset = (cache_line_size - addr % cache_line_size) % cache_line_size;
+    return reinterpret_cast<T*>(ptr + offset);
+}
+
+} /* namespace utils */
+} /* namespace avis */
@@ -25,7 +25,7 @@ constexpr auto pow(real_t x, int exp) -> real_t {
     else if (exp > 0)
         return x * pow(x, exp - 1);
     else
-        return x / pow(x, exp + 1);
+        return 1 / pow(x, -exp);
 }
 
 template <class real_t>
@@ -55,46 +55,68 @@ constexpr auto deg_to_rad(real_t x) -> real_t {
 	return (x / 180) * pi<real_t>;
 }
 
-template <int N = 5, class real_t>
+// Taylor series evaluated in double precision on [-pi, pi], each term is derived from the previous one, at most N
+// terms (converged to double precision after about 15)
+template <int N = 24, class real_t>
 constexpr auto sin(real_t x) -> real_t {
-    x = normalize_radian(x);
+    double const y = normalize_radian(static_cast<double>(x));
 
-    real_t result = x;
-    for (std::int64_t n = 1; n < N; n++)
-        result += pow(-1.0, n) * (pow(x, 2 * n + 1) / factorial(2 * n + 1));
+    double term   = y;
+    double result = y;
+    for (int n = 1; n < N; n++) {
+        term *= -y * y / ((2.0 * n) * (2.0 * n + 1));
+        if (result + term == result)
+            break;
 
-    return result;
+        result += term;
+    }
+
+    return static_cast<real_t>(result);
 }
 
-template <int N = 5, class real_t>
+template <int N = 24, class real_t>
 constexpr auto cos(real_t x) -> real_t {
-    x = normalize_radian(x);
+    double const y = normalize_radian(static_cast<double>(x));
 
-    real_t result = 1;
-    for (std::int64_t n = 1; n < N; n++)
-        result += pow(-1.0, n) * (pow(x, 2 * n) / factorial(2 * n));
+    double term   = 1;
+    double result = 1;
+    for (int n = 1; n < N; n++) {
+        term *= -y * y / ((2.0 * n - 1) * (2.0 * n));
+        if (result + term == result)
+            break;
+
+        result += term;
+    }
 
-    return result;
+    return static_cast<real_t>(result);
 }
 
-template <int N = 8, class real_t>
+template <int N = 16, class real_t>
 constexpr auto sqrt(real_t s) -> real_t {
-    // calculate estimate (s = a * 2^(2n) => s ~ 2^n)
+    if (s <= 0)
+        return 0;
+
+    // calculate estimate (s = a * 2^(2n) with 1/4 < a <= 1 => sqrt(s) ~ 2^n, within a factor of two)
     real_t x = 0;
     {
-        real_t n = 0;
-        real_t a = abs(s);
+        int n = 0;
+        real_t a = s;
         if (a < 1)
-            for (; a < 1; a *= 4, n-=2) {}
+            for (; a <= static_cast<real_t>(0.25); a *= 4, n--) {}
         else
-            for (; a > 1; a /= 4, n+=2) {}
+            for (; a > 1; a /= 4, n++) {}
 
-        x = pow(2, n);
+        x = pow(static_cast<real_t>(2), n);
     }
 
-    // babylonian method
-    for (int i = 0; i < N; i++)
-        x = (x + s / x) / 2;
+    // babylonian method, converges quadratically from the estimate, at most N iterations
+    for (int i = 0; i < N; i++) {
+        real_t const next = (x + s / x) / 2;
+        if (next == x)
+            break;
+
+        x = next;
+    }
 
     return x;
 }
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <avis/utils/aligned_buffer.hpp>
+#include <avis/utils/mirrored_memory.hpp>
+
+#include <algorithm>
+#include <cinttypes>
+#include <type_traits>
+
+
+namespace avis {
+namespace utils {
+
+// Bounded FIFO whose elements are always contiguous in memory, i.e. any range of them can be accessed through a
+// plain pointer without checking for a wrap-around. New elements are written in place at the end, the oldest ones
+// are dropped when full. Backed by mirrored_memory where available (the capacity is then rounded up to a whole
+// number of pages), otherwise by a buffer of twice the capacity which is compacted when its end is reached.
+template <class T>
+class contiguous_fifo {
+    static_assert(std::is_trivially_copyable<T>::value, "contiguous_fifo requires a trivially copyable value type!");
+
+public:
+    using value_type = T;
+
+    contiguous_fifo()
+            : mirror_{}
+            , fallback_{}
+            , base_{nullptr}
+            , capacity_{0}
+            , head_{0}
+            , size_{0} {}
+
+    inline explicit contiguous_fifo(std::size_t capacity);
+
+    contiguous_fifo(contiguous_fifo const&) = delete;
+    contiguous_fifo(contiguous_fifo&&) = default;
+
+    contiguous_fifo& operator= (contiguous_fifo const&) = delete;
+    contiguous_fifo& operator= (contiguous_fifo&&) = default;
+
+    inline auto capacity() const noexcept -> std::size_t;
+    inline auto size()     const noexcept -> std::size_t;
+    inline auto empty()    const noexcept -> bool;
+
+    // oldest element, followed by all others
+    inline auto data()       noexcept -> T*;
+    inline auto data() const noexcept -> T const*;
+
+    inline auto begin()       noexcept -> T*;
+    inline auto begin() const noexcept -> T const*;
+    inline auto end()         noexcept -> T*;
+    inline auto end()   const noexcept -> T const*;
+
+    // make room for count (at most capacity()) new elements at the end, dropping the oldest elements if required,
+    // returns the location of the new elements to be written by the caller
+    inline auto append(std::size_t count) noexcept -> T*;
+
+    inline void push(T const* src, std::size_t count) noexcept;
+    inline void push_back(T const& value) noexcept;
+
+    inline void erase_begin(std::size_t count) noexcept;
+    inline void clear() noexcept;
+
+private:
+    mirrored_memory   mirror_;
+    aligned_buffer<T> fallback_;
+    T*                base_;
+    std::size_t       capacity_;
+    std::size_t       head_;        // offset of the oldest element
+    std::size_t       size_;
+};
+
+
+template <class T>
+contiguous_fifo<T>::contiguous_fifo(std::size_t capacity)
+        : contiguous_fifo()
+{
+    auto const page_size = mirrored_memory::page_size();
+    auto const bytes     = (capacity * sizeof(T) + page_size - 1) / page_size * page_size;
+
+    mirror_ = sizeof(T) <= page_size && page_size % sizeof(T) == 0 ? mirrored_memory::create(bytes)
+                                                                   : mirrored_memory{};
+
+    if (!mirror_.empty()) {
+        base_     = reinterpret_cast<T*>(mirror_.data());
+        capacity_ = bytes / sizeof(T);
+    } else {
+        fallback_ = aligned_buffer<T>{2 * capacity};
+        base_     = fallback_.data();
+        capacity_ = capacity;
+    }
+}
+
+template <class T>
+auto contiguous_fifo<T>::capacity() const noexcept -> std::size_t {
+    return capacity_;
+}
+
+template <class T>
+auto contiguous_fifo<T>::size() const noexcept -> std::size_t {
+    return size_;
+}
+
+template <class T>
+auto contiguous_fifo<T>::empty() const noexcept -> bool {
+    return size_ == 0;
+}
+
+template <class T>
+auto contiguous_fifo<T>::data() noexcept -> T* {
+    return base_ + head_;
+}
+
+template <class T>
+auto contiguous_fifo<T>::data() const noexcept -> T const* {
+    return base_ + head_;
+}
+
+template <class T>
+auto contiguous_fifo<T>::begin() noexcept -> T* {
+    return data();
+}
+
+template <class T>
+auto contiguous_fifo<T>::begin() const noexcept -> T const* {
+    return data();
+}
+
+template <class T>
+auto contiguous_fifo<T>::end() noexcept -> T* {
+    return data() + size_;
+}
+
+template <class T>
+auto contiguous_fifo<T>::end() const noexcept -> T const* {
+    return data() + size_;
+}
+
+template <class T>
+auto contiguous_fifo<T>::append(std::size_t count) noexcept -> T* {
+    count = std::min(count, capacity_);
+
+    if (size_ + count > capacity_)
+        erase_begin(size_ + count - capacity_);
+
+    // without mirror, move the remaining elements to the start once the end of the buffer is reached
+    if (mirror_.empty() && head_ + size_ + count > 2 * capacity_) {
+        std::copy(base_ + head_, base_ + head_ + size_, base_);
+        head_ = 0;
+    }
+
+    auto const dst = base_ + head_ + size_;
+    size_ += count;
+    return dst;
+}
+
+template <class T>
+void contiguous_fifo<T>::push(T const* src, std::size_t count) noexcept {
+    // only the last capacity() elements are kept
+    if (count > capacity_) {
+        src  += count - capacity_;
+        count = capacity_;
+    }
+
+    std::copy(src, src + count, append(count));
+}
+
+template <class T>
+void contiguous_fifo<T>::push_back(T const& value) noexcept {
+    *append(1) = value;
+}
+
+template <class T>
+void contiguous_fifo<T>::erase_begin(std::size_t count) noexcept {
+    count = std::min(count, size_);
+
+    head_ += count;
+    size_ -= count;
+
+    // with mirror, the elements at head_ and head_ - capacity_ are the same
+    if (!mirror_.empty() && head_ >= capacity_)
+        head_ -= capacity_;
+}
+
+template <class T>
+void contiguous_fifo<T>::clear() noexcept {
+    head_ = 0;
+    size_ = 0;
+}
+
+} /* namespace utils */
+} /* namespace avis */
@@ -0,0 +1,37 @@
+#pragma once
+
+
+namespace avis {
+namespace utils {
+
+struct cpu_features {
+    bool sse2;
+    bool avx2;
+    bool fma;
+    bool f16c;
+    bool avx512f;
+};
+
+inline auto detect_cpu_features() noexcept -> cpu_features {
+    auto features = cpu_features{};
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+
+    features.sse2    = __builtin_cpu_supports("sse2");
+    features.avx2    = __builtin_cpu_supports("avx2");
+    features.fma     = __builtin_cpu_supports("fma");
+    features.f16c    = __builtin_cpu_supports("f16c");
+    features.avx512f = __builtin_cpu_supports("avx512f");
+#endif
+
+    return features;
+}
+
+inline auto get_cpu_features() noexcept -> cpu_features const& {
+    static auto const features = detect_cpu_features();
+    return features;
+}
+
+} /* namespace utils */
+} /* namespace avis */
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cinttypes>
+#include <utility>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+
+namespace avis {
+namespace utils {
+
+// Memory region mapped twice in a row into the address space, i.e. data()[i] and data()[size() + i] refer to the
+// same byte: any range of up to size() bytes starting inside the region is contiguous, without splitting at the
+// end. The size must be a multiple of page_size(). Backed by an anonymous shared memory file (memfd) on Linux,
+// create() returns an empty region if the mapping cannot be set up or on other platforms.
+class mirrored_memory {
+public:
+    static inline auto page_size() noexcept -> std::size_t;
+    static inline auto create(std::size_t size) noexcept -> mirrored_memory;
+
+    mirrored_memory()
+            : data_{nullptr}
+            , size_{0} {}
+
+    mirrored_memory(mirrored_memory const&) = delete;
+
+    mirrored_memory(mirrored_memory&& other)
+            : data_{std::exchange(other.data_, nullptr)}
+            , size_{std::exchange(other.size_, 0)} {}
+
+    ~mirrored_memory() { release(); }
+
+    mirrored_memory& operator= (mirrored_memory const&) = delete;
+    inline auto operator= (mirrored_memory&& rhs) -> mirrored_memory&;
+
+    inline auto data()  const noexcept -> std::uint8_t*;
+    inline auto size()  const noexcept -> std::size_t;
+    inline auto empty() const noexcept -> bool;
+
+private:
+    mirrored_memory(std::uint8_t* data, std::size_t size)
+            : data_{data}
+            , size_{size} {}
+
+    inline void release() noexcept;
+
+    std::uint8_t* data_;
+    std::size_t   size_;
+};
+
+
+auto mirrored_memory::page_size() noexcept -> std::size_t {
+#if defined(__linux__)
+    static auto const size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+#else
+    return 4096;
+#endif
+}
+
+auto mirrored_memory::create(std::size_t size) noexcept -> mirrored_memory {
+#if defined(__linux__)
+    if (size == 0 || size % page_size() != 0)
+        return {};
+
+    auto const fd = memfd_create("avis-mirrored-memory", MFD_CLOEXEC);
+    if (fd < 0)
+        return {};
+
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        close(fd);
+        return {};
+    }
+
+    // reserve the address range for both copies, then map the file into both halves of it
+    auto const base = mmap(nullptr, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        return {};
+    }
+
+    auto const data   = static_cast<std::uint8_t*>(base);
+    auto const first  = mmap(data,        size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    auto const second = mmap(data + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+
+    // the mappings keep the file alive
+    close(fd);
+
+    if (first == MAP_FAILED || second == MAP_FAILED) {
+        munmap(base, 2 * size);
+        return {};
+    }
+
+    return {data, size};
+#else
+    (void) size;
+    return {};
+#endif
+}
+
+auto mirrored_memory::operator= (mirrored_memory&& rhs) -> mirrored_memory& {
+    release();
+
+    data_ = std::exchange(rhs.data_, nullptr);
+    size_ = std::exchange(rhs.size_, 0);
+    return *this;
+}
+
+auto mirrored_memory::data() const noexcept -> std::uint8_t* {
+    return data_;
+}
+
+auto mirrored_memory::size() const noexcept -> std::size_t {
+    return size_;
+}
+
+auto mirrored_memory::empty() const noexcept -> bool {
+    return data_ == nullptr;
+}
+
+void mirrored_memory::release() noexcept {
+#if defined(__linux__)
+    if (data_ != nullptr)
+        munmap(data_, 2 * size_);
+#endif
+
+    data_ = nullptr;
+    size_ = 0;
+}
+
+} /* namespace utils */
+} /* namespace avis */
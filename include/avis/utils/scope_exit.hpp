@@ -0,0 +1,26 @@
+#pragma once
+
+#include <utility>
+
+
+namespace avis {
+namespace utils {
+
+// Invokes the given function when the returned guard goes out of scope, including during stack unwinding.
+template <class Fn>
+class on_scope_exit_impl {
+public:
+    on_scope_exit_impl(Fn&& fn) : fn_{std::forward<Fn>(fn)} {}
+    ~on_scope_exit_impl() { fn_(); }
+
+private:
+    Fn fn_;
+};
+
+template <class Fn>
+auto on_scope_exit(Fn&& fn) -> on_scope_exit_impl<Fn> {
+    return std::forward<Fn>(fn);
+}
+
+} /* namespace utils */
+} /* namespace avis */
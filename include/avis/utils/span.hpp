@@ -0,0 +1,101 @@
+#pragma once
+
+#include <algorithm>
+#include <cinttypes>
+#include <type_traits>
+
+
+namespace avis {
+namespace utils {
+
+// Non-owning view of a contiguous sequence of elements.
+template <class T>
+class span {
+public:
+    using value_type = std::remove_cv_t<T>;
+
+    span() noexcept
+            : data_{nullptr}
+            , size_{0} {}
+
+    span(T* data, std::size_t size) noexcept
+            : data_{data}
+            , size_{size} {}
+
+    inline auto data()  const noexcept -> T*;
+    inline auto size()  const noexcept -> std::size_t;
+    inline auto empty() const noexcept -> bool;
+
+    inline auto begin() const noexcept -> T*;
+    inline auto end()   const noexcept -> T*;
+
+    inline auto operator[] (std::size_t i) const noexcept -> T&;
+
+    // the first count elements, or all if there are fewer
+    inline auto first(std::size_t count) const noexcept -> span;
+
+    // the elements from offset to the end, empty if offset is past the end
+    inline auto subspan(std::size_t offset) const noexcept -> span;
+
+private:
+    T*          data_;
+    std::size_t size_;
+};
+
+// the bytes of the given span, size in bytes
+template <class T>
+inline auto as_bytes(span<T> s) noexcept
+        -> span<std::conditional_t<std::is_const<T>::value, std::uint8_t const, std::uint8_t>>;
+
+
+template <class T>
+auto span<T>::data() const noexcept -> T* {
+    return data_;
+}
+
+template <class T>
+auto span<T>::size() const noexcept -> std::size_t {
+    return size_;
+}
+
+template <class T>
+auto span<T>::empty() const noexcept -> bool {
+    return size_ == 0;
+}
+
+template <class T>
+auto span<T>::begin() const noexcept -> T* {
+    return data_;
+}
+
+template <class T>
+auto span<T>::end() const noexcept -> T* {
+    return data_ + size_;
+}
+
+template <class T>
+auto span<T>::operator[] (std::size_t i) const noexcept -> T& {
+    return data_[i];
+}
+
+template <class T>
+auto span<T>::first(std::size_t count) const noexcept -> span {
+    return {data_, std::min(count, size_)};
+}
+
+template <class T>
+auto span<T>::subspan(std::size_t offset) const noexcept -> span {
+    offset = std::min(offset, size_);
+    return {data_ + offset, size_ - offset};
+}
+
+template <class T>
+auto as_bytes(span<T> s) noexcept
+        -> span<std::conditional_t<std::is_const<T>::value, std::uint8_t const, std::uint8_t>>
+{
+    using byte_type = std::conditional_t<std::is_const<T>::value, std::uint8_t const, std::uint8_t>;
+    return {reinterpret_cast<byte_type*>(s.data()), s.size() * sizeof(T)};
+}
+
+} /* namespace utils */
+} /* namespace avis */
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <avis/utils/aligned_buffer.hpp>
+#include <avis/utils/mirrored_memory.hpp>
+#include <avis/utils/span.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cinttypes>
+#include <stdexcept>
+#include <type_traits>
+
+
+namespace avis {
+namespace utils {
+
+// Lock-free single-producer single-consumer ring buffer of frames (a fixed number of elements each, e.g. one sample
+// per channel), exposing its free and filled regions: the producer writes into the free regions and commits the
+// written frames, the consumer reads from the filled regions and commits the consumed frames. Writing directly into
+// the ring avoids staging the data in an intermediate buffer, push and pop copy from or to a buffer.
+//
+// The storage is mirrored in virtual memory (see mirrored_memory) where available, so every region is contiguous
+// and the second one is always empty. Otherwise, regions are split at the wrap-around. The capacity is rounded up
+// to a whole number of pages and frames. Consumer and producer index are kept on separate cache lines.
+template <class T>
+class spsc_ring {
+    static_assert(std::is_trivially_copyable<T>::value, "spsc_ring requires a trivially copyable value type!");
+
+public:
+    using value_type = T;
+    using regions    = std::array<span<T>, 2>;     // sizes in elements, always whole frames
+
+    inline explicit spsc_ring(std::size_t frames, std::size_t frame_size = 1);
+
+    spsc_ring(spsc_ring const&) = delete;
+    spsc_ring& operator= (spsc_ring const&) = delete;
+
+    // capacity in frames, elements per frame
+    inline auto capacity()    const noexcept -> std::size_t;
+    inline auto frame_size()  const noexcept -> std::size_t;
+    inline auto is_mirrored() const noexcept -> bool;
+
+    // frames available for reading (exact on the consumer side, a lower bound on the producer side)
+    inline auto read_available() const noexcept -> std::size_t;
+
+    // frames available for writing (exact on the producer side, a lower bound on the consumer side)
+    inline auto write_available() const noexcept -> std::size_t;
+
+    // producer: free regions in order, limited to max frames in total
+    inline auto write_regions(std::size_t max = static_cast<std::size_t>(-1)) noexcept -> regions;
+    inline void commit_write(std::size_t frames) noexcept;
+
+    // consumer: filled regions in order, limited to max frames in total
+    inline auto read_regions(std::size_t max = static_cast<std::size_t>(-1)) noexcept -> regions;
+    inline void commit_read(std::size_t frames) noexcept;
+
+    // copy up to the given number of frames into or out of the ring, returns the number of frames copied
+    inline auto push(T const* src, std::size_t frames) noexcept -> std::size_t;
+    inline auto pop(T* dst, std::size_t frames) noexcept -> std::size_t;
+
+private:
+    inline auto get_regions(std::size_t position, std::size_t frames) noexcept -> regions;
+
+    using index_type = std::atomic<std::size_t>;
+
+    index_type   read_;         // frames consumed since construction, written by the consumer
+    std::uint8_t read_padding_[cache_line_size - sizeof(index_type)];
+    index_type   write_;        // frames produced since construction, written by the producer
+    std::uint8_t write_padding_[cache_line_size - sizeof(index_type)];
+
+    std::size_t          frame_size_;
+    std::size_t          capacity_;
+    mirrored_memory      mirror_;
+    aligned_buffer<T>    fallback_;      // used if the storage cannot be mirrored
+    T*                   data_;
+};
+
+
+template <class T>
+spsc_ring<T>::spsc_ring(std::size_t frames, std::size_t frame_size)
+        : read_{0}
+        , read_padding_{}
+        , write_{0}
+        , write_padding_{}
+        , frame_size_{frame_size}
+        , capacity_{0}
+        , mirror_{}
+        , fallback_{}
+        , data_{nullptr}
+{
+    if (frames == 0 || frame_size == 0)
+        throw std::invalid_argument("The ring buffer requires a capacity of at least one frame!");
+
+    // smallest number of frames filling whole pages
+    auto const frame_bytes = frame_size * sizeof(T);
+    auto const page_size   = mirrored_memory::page_size();
+
+    auto granule = page_size;
+    while (granule % frame_bytes != 0)
+        granule += page_size;
+
+    auto const granule_frames = granule / frame_bytes;
+    capacity_ = (frames + granule_frames - 1) / granule_frames * granule_frames;
+
+    mirror_ = mirrored_memory::create(capacity_ * frame_bytes);
+
+    if (!mirror_.empty()) {
+        data_ = reinterpret_cast<T*>(mirror_.data());
+    } else {
+        fallback_ = aligned_buffer<T>{capacity_ * frame_size};
+        data_     = fallback_.data();
+    }
+}
+
+template <class T>
+auto spsc_ring<T>::capacity() const noexcept -> std::size_t {
+    return capacity_;
+}
+
+template <class T>
+auto spsc_ring<T>::frame_size() const noexcept -> std::size_t {
+    return frame_size_;
+}
+
+template <class T>
+auto spsc_ring<T>::is_mirrored() const noexcept -> bool {
+    return !mirror_.empty();
+}
+
+template <class T>
+auto spsc_ring<T>::read_available() const noexcept -> std::size_t {
+    auto const read = read_.load(std::memory_order_relaxed);
+    return write_.load(std::memory_order_acquire) - read;
+}
+
+template <class T>
+auto spsc_ring<T>::write_available() const noexcept -> std::size_t {
+    auto const write = write_.load(std::memory_order_relaxed);
+    return capacity_ - (write - read_.load(std::memory_order_acquire));
+}
+
+template <class T>
+auto spsc_ring<T>::get_regions(std::size_t position, std::size_t frames) noexcept -> regions {
+    auto const offset = position % capacity_;
+    auto const head   = is_mirrored() ? frames : std::min(frames, capacity_ - offset);
+
+    return {{
+        span<T>{data_ + offset * frame_size_, head * frame_size_},
+        span<T>{data_, (frames - head) * frame_size_},
+    }};
+}
+
+template <class T>
+auto spsc_ring<T>::write_regions(std::size_t max) noexcept -> regions {
+    return get_regions(write_.load(std::memory_order_relaxed), std::min(write_available(), max));
+}
+
+template <class T>
+void spsc_ring<T>::commit_write(std::size_t frames) noexcept {
+    write_.store(write_.load(std::memory_order_relaxed) + frames, std::memory_order_release);
+}
+
+template <class T>
+auto spsc_ring<T>::read_regions(std::size_t max) noexcept -> regions {
+    return get_regions(read_.load(std::memory_order_relaxed), std::min(read_available(), max));
+}
+
+template <class T>
+void spsc_ring<T>::commit_read(std::size_t frames) noexcept {
+    read_.store(read_.load(std::memory_order_relaxed) + frames, std::memory_order_release);
+}
+
+template <class T>
+auto spsc_ring<T>::push(T const* src, std::size_t frames) noexcept -> std::size_t {
+    auto const r = write_regions(frames);
+
+    std::copy(src, src + r[0].size(), r[0].data());
+    std::copy(src + r[0].size(), src + r[0].size() + r[1].size(), r[1].data());
+
+    auto const count = (r[0].size() + r[1].size()) / frame_size_;
+    commit_write(count);
+    return count;
+}
+
+template <class T>
+auto spsc_ring<T>::pop(T* dst, std::size_t frames) noexcept -> std::size_t {
+    auto const r = read_regions(frames);
+
+    std::copy(r[0].begin(), r[0].end(), dst);
+    std::copy(r[1].begin(), r[1].end(), dst + r[0].size());
+
+    auto const count = (r[0].size() + r[1].size()) / frame_size_;
+    commit_read(count);
+    return count;
+}
+
+} /* namespace utils */
+} /* namespace avis */
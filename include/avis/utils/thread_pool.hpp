@@ -0,0 +1,147 @@
+#pragma once
+
+#include <algorithm>
+#include <cinttypes>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+namespace avis {
+namespace utils {
+
+// Fixed set of worker threads. A job is dispatched to all workers at once, each worker invokes it with its own
+// index and is expected to process its share of the work based on that index. Dispatching does not block, the
+// caller may continue with other work and wait for completion using join().
+class thread_pool {
+public:
+    using job_type = std::function<void(std::size_t worker, std::size_t num_workers)>;
+
+    static inline auto default_concurrency() noexcept -> std::size_t;
+
+    explicit inline thread_pool(std::size_t num_threads = default_concurrency());
+    inline ~thread_pool();
+
+    thread_pool(thread_pool const&) = delete;
+    thread_pool& operator= (thread_pool const&) = delete;
+
+    inline auto size() const noexcept -> std::size_t;
+
+    inline void dispatch(job_type job);
+    inline void join();
+
+private:
+    inline void run(std::size_t index);
+
+    std::size_t              size_;
+    std::vector<std::thread> threads_;
+
+    std::mutex              mutex_;
+    std::condition_variable cv_work_;
+    std::condition_variable cv_done_;
+    job_type                job_;
+    std::uint64_t           generation_;
+    std::size_t             pending_;
+    std::exception_ptr      error_;
+    bool                    shutdown_;
+};
+
+
+auto thread_pool::default_concurrency() noexcept -> std::size_t {
+    // leave one core to the calling thread
+    auto const hw = static_cast<std::size_t>(std::thread::hardware_concurrency());
+    return std::max<std::size_t>(hw, 2) - 1;
+}
+
+thread_pool::thread_pool(std::size_t num_threads)
+        : size_{std::max<std::size_t>(num_threads, 1)}
+        , threads_{}
+        , mutex_{}
+        , cv_work_{}
+        , cv_done_{}
+        , job_{}
+        , generation_{0}
+        , pending_{0}
+        , error_{}
+        , shutdown_{false}
+{
+    threads_.reserve(size_);
+    for (std::size_t i = 0; i < size_; i++)
+        threads_.emplace_back(&thread_pool::run, this, i);
+}
+
+thread_pool::~thread_pool() {
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        shutdown_ = true;
+    }
+    cv_work_.notify_all();
+
+    for (auto& t : threads_)
+        t.join();
+}
+
+auto thread_pool::size() const noexcept -> std::size_t {
+    return size_;
+}
+
+void thread_pool::dispatch(job_type job) {
+    // only one job may be in flight at any time
+    join();
+
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        job_ = std::move(job);
+        pending_ = size_;
+        generation_++;
+    }
+    cv_work_.notify_all();
+}
+
+void thread_pool::join() {
+    std::unique_lock<std::mutex> lock{mutex_};
+    cv_done_.wait(lock, [&]{ return pending_ == 0; });
+
+    job_ = nullptr;
+
+    if (error_)
+        std::rethrow_exception(std::exchange(error_, nullptr));
+}
+
+void thread_pool::run(std::size_t index) {
+    auto generation = std::uint64_t{0};
+
+    std::unique_lock<std::mutex> lock{mutex_};
+    while (true) {
+        cv_work_.wait(lock, [&]{ return shutdown_ || generation_ != generation; });
+        if (shutdown_)
+            return;
+
+        generation = generation_;
+        auto const& job = job_;
+
+        lock.unlock();
+
+        auto error = std::exception_ptr{};
+        try {
+            job(index, size_);
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        lock.lock();
+
+        if (error && !error_)
+            error_ = error;
+
+        if (--pending_ == 0)
+            cv_done_.notify_all();
+    }
+}
+
+} /* namespace utils */
+} /* namespace avis */
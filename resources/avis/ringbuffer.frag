@@ -4,14 +4,21 @@
 layout(location = 0) in vec2 frag_texcoord;
 layout(location = 0) out vec4 out_color;
 
-layout(binding = 0) uniform sampler2D tex_sampler;
+layout(binding = 0) uniform sampler2DArray tex_sampler;    // one layer per channel, followed by mid/side
 
 layout(binding = 1) uniform tex_data_ubo {
-    int offset;
+    int   offset;
+    int   mode;         // 0: linear magnitude, 1: dB level normalized to [db_min, db_max], 2: linear power
+    float db_min;
+    float db_max;
+    int   view;         // 0: all layers stacked vertically, 1: single layer, 2: maximum over the channel layers
+    int   layer;        // layer shown in single view
+    int   channels;     // number of channel layers
+    float xview_begin;  // displayed range of the texture width, as fraction of it
+    float xview_end;
 } tex_data;
 
 
-#define xview   vec2(0.9, 1.0)
 #define scale   0.3;
 
 
@@ -20,15 +27,45 @@ vec2 project(float xmin, float xmax, float ysize, float y_offset, vec2 v) {
 }
 
 void main() {
-    vec2 texsize  = textureSize(tex_sampler, 0).st;
-    vec2 texcoord = project(texsize.x * xview.x, texsize.x * xview.y, texsize.y, tex_data.offset, frag_texcoord.ts);
+    vec3 texsize = textureSize(tex_sampler, 0);
 
-    float val = texture(tex_sampler, texcoord).r;
+    float layers  = texsize.z;
+    float layer   = clamp(float(tex_data.layer), 0.0, layers - 1.0);
+    vec2  viewpos = frag_texcoord;
+
+    // stacked view: layers are stacked vertically on screen
+    if (tex_data.view == 0) {
+        layer   = min(floor(frag_texcoord.t * layers), layers - 1.0);
+        viewpos = vec2(frag_texcoord.s, frag_texcoord.t * layers - layer);
+    }
+
+    vec2 texcoord = project(texsize.x * tex_data.xview_begin, texsize.x * tex_data.xview_end, texsize.y,
+            tex_data.offset, viewpos.ts);
+
+    float val = texture(tex_sampler, vec3(texcoord / texsize.xy, layer)).r;
+
+    // maximum view: blend the channel layers by taking the maximum (all encodings are monotonic)
+    if (tex_data.view == 2) {
+        val = texture(tex_sampler, vec3(texcoord / texsize.xy, 0.0)).r;
+        for (int i = 1; i < tex_data.channels; i++)
+            val = max(val, texture(tex_sampler, vec3(texcoord / texsize.xy, float(i))).r);
+    }
 
     vec3 color = vec3(0.0, 0.0, 0.0);
-    color = mix(color, vec3(1.0, 1.0, 1.0), smoothstep(0.00, 1.00, val));   // white
-    color = mix(color, vec3(1.0, 0.5, 0.0), smoothstep(1.00, 3.00, val));   // orange
-    color = mix(color, vec3(1.0, 0.0, 0.0), smoothstep(3.00, 6.00, val));   // red
+    if (tex_data.mode == 0) {
+        color = mix(color, vec3(1.0, 1.0, 1.0), smoothstep(0.00, 1.00, val));   // white
+        color = mix(color, vec3(1.0, 0.5, 0.0), smoothstep(1.00, 3.00, val));   // orange
+        color = mix(color, vec3(1.0, 0.0, 0.0), smoothstep(3.00, 6.00, val));   // red
+    } else if (tex_data.mode == 2) {
+        color = mix(color, vec3(1.0, 1.0, 1.0), smoothstep(0.00,  1.00, val));  // white
+        color = mix(color, vec3(1.0, 0.5, 0.0), smoothstep(1.00,  9.00, val));  // orange
+        color = mix(color, vec3(1.0, 0.0, 0.0), smoothstep(9.00, 36.00, val));  // red
+    } else {
+        float db = mix(tex_data.db_min, tex_data.db_max, val);
+        color = mix(color, vec3(1.0, 1.0, 1.0), smoothstep(-40.0,  0.0, db));   // white
+        color = mix(color, vec3(1.0, 0.5, 0.0), smoothstep(  0.0,  9.5, db));   // orange
+        color = mix(color, vec3(1.0, 0.0, 0.0), smoothstep(  9.5, 15.6, db));   // red
+    }
 
     out_color = vec4(color, 1.0);
 }
@@ -2,13 +2,20 @@
 
 #include <avis/utils/fileio.hpp>
 #include <avis/audio/fft.hpp>
+#include <avis/audio/sdft.hpp>
+#include <avis/audio/encoding.hpp>
+#include <avis/audio/channels.hpp>
+#include <avis/audio/filterbank.hpp>
 
 
 #include <iostream>
 #include <algorithm>
+#include <iterator>
 #include <random>
 #include <chrono>
 #include <thread>
+#include <cstring>
+#include <numeric>
 
 
 using namespace std::literals::chrono_literals;
@@ -18,32 +25,198 @@ namespace avis {
 constexpr bool print_frame_time = false;
 
 
+static auto make_sliding_dft(std::size_t n) -> audio::sliding_dft<float> {
+    auto bins = std::vector<std::size_t>(sliding_dft_bins);
+    std::iota(bins.begin(), bins.end(), 1);
+    return audio::sliding_dft<float>{n, std::move(bins)};
+}
+
+static auto next_spectrum_encoding(audio::spectrum_encoding encoding) noexcept -> audio::spectrum_encoding {
+    switch (encoding) {
+    case audio::spectrum_encoding::linear_f32:  return audio::spectrum_encoding::db_f16;
+    case audio::spectrum_encoding::db_f16:      return audio::spectrum_encoding::db_u8;
+    default:                                    return audio::spectrum_encoding::linear_f32;
+    }
+}
+
+static auto next_magnitude_mode(audio::magnitude_mode mode) noexcept -> audio::magnitude_mode {
+    switch (mode) {
+    case audio::magnitude_mode::magnitude:  return audio::magnitude_mode::power;
+    case audio::magnitude_mode::power:      return audio::magnitude_mode::approximate;
+    default:                                return audio::magnitude_mode::magnitude;
+    }
+}
+
+// Stereo downmix for playback: front left/right go to their side, the other left/right channels are added to
+// their side at -3 dB, center channels to both sides at -3 dB, LFE is dropped. Gains are normalized to avoid
+// clipping. Returns the left and right gain per channel.
+static auto make_stereo_downmix(audio::ffmpeg::stream_format const& fmt) -> std::vector<float> {
+    constexpr auto left  = AV_CH_FRONT_LEFT_OF_CENTER | AV_CH_BACK_LEFT | AV_CH_SIDE_LEFT | AV_CH_TOP_FRONT_LEFT
+            | AV_CH_TOP_BACK_LEFT | AV_CH_WIDE_LEFT | AV_CH_SURROUND_DIRECT_LEFT;
+    constexpr auto right = AV_CH_FRONT_RIGHT_OF_CENTER | AV_CH_BACK_RIGHT | AV_CH_SIDE_RIGHT | AV_CH_TOP_FRONT_RIGHT
+            | AV_CH_TOP_BACK_RIGHT | AV_CH_WIDE_RIGHT | AV_CH_SURROUND_DIRECT_RIGHT;
+    constexpr auto attenuation = 0.70710678f;
+
+    auto gains = std::vector<float>(2 * fmt.channels);
+
+    if (fmt.channels == 1) {
+        gains = {1.0f, 1.0f};
+        return gains;
+    }
+
+    for (int c = 0; c < fmt.channels; c++) {
+        auto const channel = av_channel_layout_extract_channel(fmt.channel_layout, c);
+
+        if (channel == AV_CH_FRONT_LEFT) {
+            gains[2 * c] = 1.0f;
+        } else if (channel == AV_CH_FRONT_RIGHT) {
+            gains[2 * c + 1] = 1.0f;
+        } else if (channel == AV_CH_LOW_FREQUENCY || channel == AV_CH_LOW_FREQUENCY_2) {
+            continue;
+        } else if (channel & left) {
+            gains[2 * c] = attenuation;
+        } else if (channel & right) {
+            gains[2 * c + 1] = attenuation;
+        } else {
+            gains[2 * c]     = attenuation;
+            gains[2 * c + 1] = attenuation;
+        }
+    }
+
+    auto sum_left  = 0.0f;
+    auto sum_right = 0.0f;
+    for (int c = 0; c < fmt.channels; c++) {
+        sum_left  += gains[2 * c];
+        sum_right += gains[2 * c + 1];
+    }
+
+    auto const norm = std::max({sum_left, sum_right, 1.0f});
+    for (auto& g : gains)
+        g /= norm;
+
+    return gains;
+}
+
+static auto next_frequency_scale(audio::frequency_scale scale) noexcept -> audio::frequency_scale {
+    switch (scale) {
+    case audio::frequency_scale::linear:        return audio::frequency_scale::mel;
+    case audio::frequency_scale::mel:           return audio::frequency_scale::log;
+    case audio::frequency_scale::log:           return audio::frequency_scale::constant_q;
+    case audio::frequency_scale::constant_q:    return audio::frequency_scale::multires;
+    default:                                    return audio::frequency_scale::linear;
+    }
+}
+
+// the sliding DFT only tracks a subset of the bins, scales requiring the full spectrum are not available
+static auto supports_sliding_dft(audio::frequency_scale scale) noexcept -> bool {
+    return scale != audio::frequency_scale::constant_q && scale != audio::frequency_scale::multires;
+}
+
+// the features are computed from the FFT bins before any rebinning
+static auto supports_features(audio::frequency_scale scale) noexcept -> bool {
+    return scale == audio::frequency_scale::linear || scale == audio::frequency_scale::mel
+        || scale == audio::frequency_scale::log;
+}
+
+static auto next_decimation(std::size_t factor) noexcept -> std::size_t {
+    auto const it = std::find(selectable_decimations.begin(), selectable_decimations.end(), factor);
+    if (it == selectable_decimations.end() || it + 1 == selectable_decimations.end())
+        return selectable_decimations.front();
+
+    return *(it + 1);
+}
+
+static auto next_layer_view(layer_view view) noexcept -> layer_view {
+    switch (view) {
+    case layer_view::stacked:   return layer_view::single;
+    case layer_view::single:    return layer_view::maximum;
+    default:                    return layer_view::stacked;
+    }
+}
+
+// contiguous part of the given ring buffer regions starting at the given offset into them
+template <class T>
+static auto get_region_at(std::array<utils::span<T>, 2> const& regions, std::size_t offset) noexcept
+        -> utils::span<T>
+{
+    if (offset < regions[0].size())
+        return regions[0].subspan(offset);
+
+    return regions[1].subspan(offset - regions[0].size());
+}
+
+static auto get_texture_format(audio::spectrum_encoding encoding) noexcept -> VkFormat {
+    switch (encoding) {
+    case audio::spectrum_encoding::db_f16:  return VK_FORMAT_R16_SFLOAT;
+    case audio::spectrum_encoding::db_u8:   return VK_FORMAT_R8_UNORM;
+    default:                                return VK_FORMAT_R32_SFLOAT;
+    }
+}
+
+
 void application::play(std::string const& file) {
-    // setup audio fields
-    audio_out_sample_size_ = audio::ffmpeg::get_pcm_sample_size(audio_out_fmt);
+    // set up input stream, decoded using the channel layout of the file
+    audio_in_     = audio::ffmpeg::audio_input_stream::open_native(audio_out_fmt, file);
+    audio_in_fmt_ = audio_in_.get_format();
+    mid_side_     = false;
 
+    // setup audio fields
     int64_t qsize = 1L * audio_out_fmt.sample_rate * 32 / 8;   // store 1 second with 32bit precision
-    audio_queue_ = std::make_unique<boost::lockfree::spsc_queue<uint8_t>>(qsize * audio_out_fmt.channels);
-    audio_imgbuf_ = boost::circular_buffer<float>(qsize * 2 / 4);
+    audio_queue_ = std::make_unique<utils::spsc_ring<float>>(qsize / 4, audio_out_fmt.channels);
+
+    // contiguous image buffers, the transforms read them through plain pointers
+    audio_imgbuf_.clear();
+    for (std::uint32_t layer = 0; layer < get_texture_layers(); layer++)
+        audio_imgbuf_.emplace_back(qsize * 2 / 4);
+
+    // the analysis queue holds the same second of samples in the channel layout of the file, the decoder writes
+    // into it directly
+    audio_analysis_queue_ = std::make_unique<utils::spsc_ring<float>>(qsize / 4, audio_in_fmt_.channels);
 
-    int64_t rdbsize = audio_out_sample_size_ * 1024 * 64L;
-    audio_rdbuf_ = std::vector<uint8_t>(rdbsize);
+    audio_queue_refill_    = static_cast<std::size_t>(audio_queue_->capacity() * decoder_refill_fraction);
+    audio_analysis_refill_ = static_cast<std::size_t>(audio_analysis_queue_->capacity() * decoder_refill_fraction);
+
+    audio_downmix_ = make_stereo_downmix(audio_in_fmt_);
 
     audio_eof_ = false;
     audio_samples_written_   = 0;
     audio_samples_displayed_ = 0;
+    audio_feature_row_       = 0;
+
+    audio_sdft_.assign(get_texture_layers(), make_sliding_dft(chunk_size_));
+    reset_decimation();
+    setup_row_buffers();
+    setup_feature_extractors();
 
-    // set up streams
+    // set up output stream
     auto const pa_fmt = audio::portaudio::make_stream_format(audio_out_fmt);
     audio_out_ = audio::portaudio::output_stream::open_default(pa_fmt, 256, [this](auto... p) {
         return this->cb_audio(p...);}
     );
-    audio_in_ = audio::ffmpeg::audio_input_stream::open_default(audio_out_fmt, file);
+
+    // decode ahead on a separate thread, the render loop only consumes the analysis queue
+    audio_decoder_stop_         = false;
+    audio_decoder_waiting_      = false;
+    audio_decoder_playback_low_ = false;
+    audio_decoder_failed_       = false;
+    audio_decoder_error_        = nullptr;
+    audio_decoder_ = std::thread(&application::decode_loop, this);
 
     paused_ = false;
     audio_out_.start();
-    application_base::run();
+
+    try {
+        application_base::run();
+    } catch (...) {
+        stop_decoder();
+        throw;
+    }
+
+    stop_decoder();
     audio_out_.stop();
+
+    if (audio_decoder_error_)
+        std::rethrow_exception(std::exchange(audio_decoder_error_, nullptr));
 }
 
 
@@ -348,35 +521,29 @@ void application::setup_screenquad() {
 
 void application::setup_texture() {
     auto const device = get_device().get_handle();
+    auto const layers = get_texture_layers();
+
+    // create staging buffer: the layers follow each other, each consisting of chunks rows (a linear image with
+    // all layers stacked would exceed the guaranteed maximum image height for more than four layers), rows are
+    // aligned to 64 bytes
+    auto const texel_size = static_cast<VkDeviceSize>(audio::encoded_bin_size(encoding_));
+    auto const row_pitch  = (get_texture_extent().width * texel_size + 63) / 64 * 64;
+    auto const staging_size = row_pitch * chunks * layers;
 
-    // create staging texture image
-    auto staging_image_info = VkImageCreateInfo{};
-    staging_image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-    staging_image_info.imageType     = VK_IMAGE_TYPE_2D;
-    staging_image_info.extent        = texture_extent;
-    staging_image_info.mipLevels     = 1;
-    staging_image_info.arrayLayers   = 1;
-    staging_image_info.format        = VK_FORMAT_R32_SFLOAT;
-    staging_image_info.tiling        = VK_IMAGE_TILING_LINEAR;
-    staging_image_info.initialLayout = VK_IMAGE_LAYOUT_PREINITIALIZED;
-    staging_image_info.usage         = VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
-    staging_image_info.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
-    staging_image_info.samples       = VK_SAMPLE_COUNT_1_BIT;
-    staging_image_info.flags         = 0;
-
-    auto memory_staging_flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-    auto tex_staging_image = vulkan::make_image(device, get_device().get_physical_device(), staging_image_info,
-            memory_staging_flags).move_or_throw();
+    auto const staging_usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    auto const staging_flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    auto tex_staging_buffer = vulkan::make_exclusive_buffer(device, get_device().get_physical_device(),
+            staging_size, staging_usage, staging_flags).move_or_throw();
 
     // create device_local texture image
     auto image_info = VkImageCreateInfo{};
     image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     image_info.imageType     = VK_IMAGE_TYPE_2D;
-    image_info.extent        = texture_extent;
+    image_info.extent        = get_texture_extent();
     image_info.mipLevels     = 1;
-    image_info.arrayLayers   = 1;
-    image_info.format        = VK_FORMAT_R32_SFLOAT;
-    image_info.tiling        = VK_IMAGE_TILING_LINEAR;
+    image_info.arrayLayers   = layers;
+    image_info.format        = get_texture_format(encoding_);
+    image_info.tiling        = VK_IMAGE_TILING_OPTIMAL;
     image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
     image_info.usage         = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
     image_info.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
@@ -387,32 +554,16 @@ void application::setup_texture() {
     auto tex_image = vulkan::make_image(device, get_device().get_physical_device(), image_info, memory_flags)
             .move_or_throw();
 
-    // clear staging image
+    // clear staging buffer
     {
-        void* data = tex_staging_image.map_memory(device, 0, texture_bytes, 0).move_or_throw();
-        std::fill(static_cast<std::uint8_t*>(data), static_cast<std::uint8_t*>(data) + texture_bytes, 0);
-        tex_staging_image.unmap_memory(device);
+        void* data = tex_staging_buffer.map_memory(device, 0, staging_size, 0).move_or_throw();
+        std::fill(static_cast<std::uint8_t*>(data), static_cast<std::uint8_t*>(data) + staging_size, 0);
+        tex_staging_buffer.unmap_memory(device);
     }
 
-    // prepare for use: transition image layouts and transfer staging to device-local
+    // prepare for use: transition image layout and transfer staging to device-local
     {
-        // prepare for use: create memory barriers to transform layouts
-        auto staging_barrier = VkImageMemoryBarrier{};
-        staging_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        staging_barrier.oldLayout           = VK_IMAGE_LAYOUT_PREINITIALIZED;
-        staging_barrier.newLayout           = VK_IMAGE_LAYOUT_GENERAL;
-        staging_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        staging_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        staging_barrier.image               = tex_staging_image.get_handle();
-        staging_barrier.srcAccessMask       = VK_ACCESS_HOST_WRITE_BIT;
-        staging_barrier.dstAccessMask       = VK_ACCESS_HOST_WRITE_BIT;
-
-        staging_barrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
-        staging_barrier.subresourceRange.baseMipLevel   = 0;
-        staging_barrier.subresourceRange.levelCount     = 1;
-        staging_barrier.subresourceRange.baseArrayLayer = 0;
-        staging_barrier.subresourceRange.layerCount     = 1;
-
+        // prepare for use: create memory barrier to transform layout
         auto barrier = VkImageMemoryBarrier{};
         barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
         barrier.oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -427,7 +578,7 @@ void application::setup_texture() {
         barrier.subresourceRange.baseMipLevel   = 0;
         barrier.subresourceRange.levelCount     = 1;
         barrier.subresourceRange.baseArrayLayer = 0;
-        barrier.subresourceRange.layerCount     = 1;
+        barrier.subresourceRange.layerCount     = layers;
 
         // prepare for use: place barrier
         auto alloc_info = VkCommandBufferAllocateInfo{};
@@ -445,20 +596,19 @@ void application::setup_texture() {
 
         vulkan::except(vkBeginCommandBuffer(cmdbuf, &begin_info));
 
-        vkCmdPipelineBarrier(cmdbuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-            0, 0, nullptr, 0, nullptr, 1, &staging_barrier);
-
         vkCmdPipelineBarrier(cmdbuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
             0, 0, nullptr, 0, nullptr, 1, &barrier);
 
-        auto img_copy = VkImageCopy{};
-        img_copy.srcOffset      = {0, 0, 0};
-        img_copy.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
-        img_copy.dstOffset      = {0, 0, 0};
-        img_copy.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
-        img_copy.extent         = texture_extent;
-        vkCmdCopyImage(cmdbuf, tex_staging_image.get_handle(), VK_IMAGE_LAYOUT_GENERAL,
-                tex_image.get_handle(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &img_copy);
+        auto region = VkBufferImageCopy{};
+        region.bufferOffset      = 0;
+        region.bufferRowLength   = static_cast<std::uint32_t>(row_pitch / texel_size);
+        region.bufferImageHeight = chunks;
+        region.imageSubresource  = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, layers};
+        region.imageOffset       = {0, 0, 0};
+        region.imageExtent       = get_texture_extent();
+
+        vkCmdCopyBufferToImage(cmdbuf, tex_staging_buffer.get_handle(), tex_image.get_handle(),
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
 
         vulkan::except(vkEndCommandBuffer(cmdbuf));
 
@@ -475,14 +625,14 @@ void application::setup_texture() {
     auto view_info = VkImageViewCreateInfo{};
     view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
     view_info.image    = tex_image.get_handle();
-    view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
-    view_info.format   = VK_FORMAT_R32_SFLOAT;
+    view_info.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+    view_info.format   = get_texture_format(encoding_);
 
     view_info.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
     view_info.subresourceRange.baseMipLevel   = 0;
     view_info.subresourceRange.levelCount     = 1;
     view_info.subresourceRange.baseArrayLayer = 0;
-    view_info.subresourceRange.layerCount     = 1;
+    view_info.subresourceRange.layerCount     = layers;
 
     auto tex_view = vulkan::make_image_view(device, view_info).move_or_throw();
 
@@ -497,7 +647,7 @@ void application::setup_texture() {
     sampler_info.anisotropyEnable        = false;
     sampler_info.maxAnisotropy           = 16;
     sampler_info.borderColor             = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
-    sampler_info.unnormalizedCoordinates = true;
+    sampler_info.unnormalizedCoordinates = false;     // not supported for array views
     sampler_info.compareEnable           = false;
     sampler_info.compareOp               = VK_COMPARE_OP_ALWAYS;
     sampler_info.mipmapMode              = VK_SAMPLER_MIPMAP_MODE_NEAREST;
@@ -525,17 +675,19 @@ void application::setup_texture() {
     vkUpdateDescriptorSets(device, 1, &descriptor_write, 0, nullptr);
 
     // set handles
-    texture_staging_image_ = std::move(tex_staging_image);
-    texture_image_         = std::move(tex_image);
-    texture_view_          = std::move(tex_view);
-    texture_sampler_       = std::move(tex_sampler);
+    texture_staging_buffer_ = std::move(tex_staging_buffer);
+    texture_image_          = std::move(tex_image);
+    texture_view_           = std::move(tex_view);
+    texture_sampler_        = std::move(tex_sampler);
+    texture_row_pitch_      = row_pitch;
+    texture_layers_         = layers;
 }
 
 void application::setup_uniform_buffer() {
     // create uniform buffers
     auto const logical  = get_device().get_handle();
     auto const physical = get_device().get_physical_device();
-    auto const size     = sizeof(std::int32_t);
+    auto const size     = sizeof(texture_uniforms);
 
     auto const staging_usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
     auto const staging_flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
@@ -553,7 +705,7 @@ void application::setup_uniform_buffer() {
     auto desc_info = VkDescriptorBufferInfo{};
     desc_info.buffer = buffer.get_handle();
     desc_info.offset = 0;
-    desc_info.range  = sizeof(std::int32_t);
+    desc_info.range  = sizeof(texture_uniforms);
 
     auto desc_write = VkWriteDescriptorSet{};
     desc_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
@@ -589,64 +741,31 @@ void application::setup_transfer_cmdbuffer(std::vector<std::tuple<std::int32_t,
     vulkan::except(vkBeginCommandBuffer(command_buffer.get_handle(), &begin_info));
 
     if (!range.empty()) {
-        // transition image to transfer-src layout
-        auto img_barrier_start = VkImageMemoryBarrier{};
-        img_barrier_start.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        img_barrier_start.oldLayout           = VK_IMAGE_LAYOUT_GENERAL;
-        img_barrier_start.newLayout           = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-        img_barrier_start.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        img_barrier_start.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        img_barrier_start.image               = texture_staging_image_.get_handle();
-        img_barrier_start.srcAccessMask       = VK_ACCESS_HOST_WRITE_BIT;
-        img_barrier_start.dstAccessMask       = VK_ACCESS_TRANSFER_READ_BIT;
+        // copy each range of all layers at once, the layers follow each other in the staging buffer
+        auto const row_length = texture_row_pitch_ / audio::encoded_bin_size(encoding_);
 
-        img_barrier_start.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
-        img_barrier_start.subresourceRange.baseMipLevel   = 0;
-        img_barrier_start.subresourceRange.levelCount     = 1;
-        img_barrier_start.subresourceRange.baseArrayLayer = 0;
-        img_barrier_start.subresourceRange.layerCount     = 1;
-
-        vkCmdPipelineBarrier(command_buffer.get_handle(), VK_PIPELINE_STAGE_HOST_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
-                0, nullptr, 0, nullptr, 1, &img_barrier_start);
-
-        auto img_copy = std::vector<VkImageCopy>(range.size());
-        for (int i = 0; i < range.size(); i++) {
-            img_copy[i].srcOffset      = {0, std::get<0>(range[i]), 0};
-            img_copy[i].srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
-            img_copy[i].dstOffset      = {0, std::get<0>(range[i]), 0};
-            img_copy[i].dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
-            img_copy[i].extent         = {texture_extent.width, std::get<1>(range[i]), 1};
+        auto regions = std::vector<VkBufferImageCopy>();
+        for (auto const& r : range) {
+            auto region = VkBufferImageCopy{};
+            region.bufferOffset      = std::get<0>(r) * texture_row_pitch_;
+            region.bufferRowLength   = static_cast<std::uint32_t>(row_length);
+            region.bufferImageHeight = chunks;
+            region.imageSubresource  = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, texture_layers_};
+            region.imageOffset       = {0, std::get<0>(r), 0};
+            region.imageExtent       = {get_texture_extent().width, std::get<1>(r), 1};
+            regions.push_back(region);
         }
-        vkCmdCopyImage(command_buffer.get_handle(), texture_staging_image_.get_handle(),
-                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, texture_image_.get_handle(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                img_copy.size(), img_copy.data());
-
-        auto img_barrier_stop = VkImageMemoryBarrier{};
-        img_barrier_stop.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        img_barrier_stop.oldLayout           = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-        img_barrier_stop.newLayout           = VK_IMAGE_LAYOUT_GENERAL;
-        img_barrier_stop.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        img_barrier_stop.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        img_barrier_stop.image               = texture_staging_image_.get_handle();
-        img_barrier_stop.srcAccessMask       = VK_ACCESS_TRANSFER_READ_BIT;
-        img_barrier_stop.dstAccessMask       = VK_ACCESS_HOST_WRITE_BIT;
-
-        img_barrier_stop.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
-        img_barrier_stop.subresourceRange.baseMipLevel   = 0;
-        img_barrier_stop.subresourceRange.levelCount     = 1;
-        img_barrier_stop.subresourceRange.baseArrayLayer = 0;
-        img_barrier_stop.subresourceRange.layerCount     = 1;
-
-        vkCmdPipelineBarrier(command_buffer.get_handle(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
-                0, nullptr, 0, nullptr, 1, &img_barrier_stop);
-
-        auto buf_copy = VkBufferCopy{};
-        buf_copy.srcOffset = 0;
-        buf_copy.dstOffset = 0;
-        buf_copy.size = sizeof(std::int32_t);
-        vkCmdCopyBuffer(command_buffer.get_handle(), uniform_staging_buffer_.get_handle(), uniform_buffer_.get_handle(), 1, &buf_copy);
+        vkCmdCopyBufferToImage(command_buffer.get_handle(), texture_staging_buffer_.get_handle(),
+                texture_image_.get_handle(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, regions.size(), regions.data());
     }
 
+    // the uniforms are updated every frame
+    auto buf_copy = VkBufferCopy{};
+    buf_copy.srcOffset = 0;
+    buf_copy.dstOffset = 0;
+    buf_copy.size = sizeof(texture_uniforms);
+    vkCmdCopyBuffer(command_buffer.get_handle(), uniform_staging_buffer_.get_handle(), uniform_buffer_.get_handle(), 1, &buf_copy);
+
     vulkan::except(vkEndCommandBuffer(command_buffer.get_handle()));
 
     transfer_cmdbuffer_ = std::move(command_buffer);
@@ -688,7 +807,7 @@ void application::setup_command_buffers() {
         img_barrier_start.subresourceRange.baseMipLevel   = 0;
         img_barrier_start.subresourceRange.levelCount     = 1;
         img_barrier_start.subresourceRange.baseArrayLayer = 0;
-        img_barrier_start.subresourceRange.layerCount     = 1;
+        img_barrier_start.subresourceRange.layerCount     = texture_layers_;
 
         vkCmdPipelineBarrier(buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
                 0, nullptr, 0, nullptr, 1, &img_barrier_start);
@@ -729,7 +848,7 @@ void application::setup_command_buffers() {
         img_barrier_end.subresourceRange.baseMipLevel   = 0;
         img_barrier_end.subresourceRange.levelCount     = 1;
         img_barrier_end.subresourceRange.baseArrayLayer = 0;
-        img_barrier_end.subresourceRange.layerCount     = 1;
+        img_barrier_end.subresourceRange.layerCount     = texture_layers_;
 
         vkCmdPipelineBarrier(buffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
                 0, nullptr, 0, nullptr, 1, &img_barrier_end);
@@ -794,19 +913,23 @@ void application::cb_display() {
 }
 
 int application::cb_audio(void* outbuf, unsigned long framecount, PaStreamCallbackTimeInfo const* time, unsigned long flags) {
-    auto out = reinterpret_cast<uint8_t*>(outbuf);
-    auto len_bytes = framecount * audio_out_sample_size_;
+    auto out = reinterpret_cast<float*>(outbuf);
+    auto len = framecount * audio_out_fmt.channels;
 
     if (!paused_) {
-        auto count = audio_queue_->pop(out, len_bytes);
-        std::fill(out + count, out + len_bytes, 0);
+        auto count = audio_queue_->pop(out, framecount);
+        std::fill(out + count * audio_out_fmt.channels, out + len, 0.0f);
 
-        audio_samples_written_ += count / audio_out_sample_size_;
+        audio_samples_written_ += count;
 
-        if (count < len_bytes && audio_eof_)
+        // only flag the refill level, frame_update() wakes the decoder on behalf of this (real-time) thread
+        if (audio_queue_->read_available() <= audio_queue_refill_)
+            audio_decoder_playback_low_.store(true, std::memory_order_relaxed);
+
+        if (count < framecount && audio_eof_)
             return paComplete;
     } else {
-        std::fill(out, out + len_bytes, 0);
+        std::fill(out, out + len, 0.0f);
     }
 
     return paContinue;
@@ -814,35 +937,309 @@ int application::cb_audio(void* outbuf, unsigned long framecount, PaStreamCallba
 
 
 void application::frame_update() {
+    // a decoder error ends playback: raise it here instead of leaving the window open without audio, play() stops
+    // the decoder while unwinding
+    if (audio_decoder_failed_.load(std::memory_order_acquire) && audio_decoder_error_)
+        std::rethrow_exception(std::exchange(audio_decoder_error_, nullptr));
+
     if (paused_) return;
 
-    int64_t available = audio_queue_->write_available();
-    int64_t written = 0;
+    auto const channels = static_cast<std::size_t>(audio_in_fmt_.channels);
+    auto const capacity = audio_imgbuf_.front().capacity();
+
+    // take everything decoded so far, deinterleaving all channels at once from the analysis queue directly into
+    // the image buffers (deriving mid/side in the same pass)
+    auto const regions = audio_analysis_queue_->read_regions();
+    auto planes = std::vector<float*>(audio_imgbuf_.size());
 
-    while (written < available && !audio_in_.eof()) {
-        int64_t requested = std::min(static_cast<int64_t>(audio_rdbuf_.capacity()), available - written) / audio_out_sample_size_;
-        int64_t len_samples = audio_in_.read(audio_rdbuf_.data(), requested);
-        int64_t len_bytes = len_samples * audio_out_sample_size_;
+    for (auto const& region : regions) {
+        for (std::size_t offset = 0; offset < region.size(); offset += capacity * channels) {
+            auto const len_samples = std::min(region.size() - offset, capacity * channels) / channels;
 
-        // write to audio queue
-        int64_t pushed = 0;
-        while (pushed != len_bytes)
-            pushed += audio_queue_->push(audio_rdbuf_.data() + pushed, len_bytes - pushed);
+            for (std::size_t layer = 0; layer < planes.size(); layer++)
+                planes[layer] = audio_imgbuf_[layer].append(len_samples);
 
-        // write single channel to image buffer
-        for (int64_t i = 0; i < len_samples * audio_out_fmt.channels; i+= audio_out_fmt.channels)
-            audio_imgbuf_.push_back(reinterpret_cast<float*>(audio_rdbuf_.data())[i]);
+            auto const mid  = mid_side_ ? planes[channels]     : nullptr;
+            auto const side = mid_side_ ? planes[channels + 1] : nullptr;
+            audio::deinterleave(region.data() + offset, len_samples, channels, planes.data(), mid, side);
+        }
+    }
+
+    audio_analysis_queue_->commit_read((regions[0].size() + regions[1].size()) / channels);
+
+    // wake the decoder once both queues are at their refill level. The audio callback only flags the playback
+    // queue and keeps doing so while it is low, a flag consumed before the decoder waits is thus raised again.
+    // Taking the lock ensures the decoder either has not yet checked the queues or is already waiting.
+    if (audio_decoder_waiting_ && audio_analysis_queue_->read_available() <= audio_analysis_refill_
+            && audio_decoder_playback_low_.exchange(false, std::memory_order_relaxed)) {
+        { std::lock_guard<std::mutex> lock{audio_decoder_mutex_}; }
+        audio_decoder_cv_.notify_one();
+    }
+}
+
+void application::decode_loop() {
+    auto const channels          = static_cast<std::size_t>(audio_in_fmt_.channels);
+    auto const playback_channels = static_cast<std::size_t>(audio_out_fmt.channels);
+
+    try {
+        while (!audio_decoder_stop_ && !audio_in_.eof()) {
+            // decode as many frames as fit into both queues, sleep once either is full
+            auto const available = std::min(audio_queue_->write_available(), audio_analysis_queue_->write_available());
+
+            if (available == 0) {
+                wait_for_decoder_queues();
+                continue;
+            }
+
+            // decode directly into the analysis queue, using the channel layout of the file
+            auto const analysis = audio_analysis_queue_->write_regions(available);
+            auto const frames = static_cast<std::size_t>(audio_in_.read_into(utils::as_bytes(analysis[0]),
+                    utils::as_bytes(analysis[1])));
+
+            // write to audio queue in a single pass, anything but stereo is downmixed for playback (split where
+            // either queue wraps around, if their storage is not mirrored)
+            auto const playback = audio_queue_->write_regions(frames);
 
-        written += pushed;
+            for (std::size_t done = 0; done < frames;) {
+                auto const src = get_region_at(analysis, done * channels);
+                auto const dst = get_region_at(playback, done * playback_channels);
+                auto const len = std::min(src.size() / channels, dst.size() / playback_channels);
+
+                if (channels != playback_channels)
+                    audio::downmix_stereo(src.data(), len, channels, audio_downmix_.data(), dst.data());
+                else
+                    std::copy(src.begin(), src.begin() + len * channels, dst.data());
+
+                done += len;
+            }
+
+            // this thread is the only producer of both queues
+            audio_analysis_queue_->commit_write(frames);
+            audio_queue_->commit_write(frames);
+        }
+    } catch (...) {
+        audio_decoder_error_ = std::current_exception();
+        audio_decoder_failed_.store(true, std::memory_order_release);
     }
 
-    if (audio_in_.eof())
-        audio_eof_ = true;
+    audio_eof_ = true;
+}
+
+// sleep until both queues have been drained to their refill level. Only frame_update() notifies: the audio callback
+// does not (which may involve a syscall), it flags the playback queue for frame_update() instead.
+void application::wait_for_decoder_queues() {
+    auto const drained = [this] {
+        auto const& playback = *audio_queue_;
+        auto const& analysis = *audio_analysis_queue_;
+
+        return playback.write_available() >= playback.capacity() - audio_queue_refill_
+                && analysis.write_available() >= analysis.capacity() - audio_analysis_refill_;
+    };
+
+    std::unique_lock<std::mutex> lock{audio_decoder_mutex_};
+    audio_decoder_waiting_ = true;
+
+    while (!audio_decoder_stop_ && !drained())
+        audio_decoder_cv_.wait_for(lock, decoder_wait_timeout);
+
+    audio_decoder_waiting_ = false;
+}
+
+void application::stop_decoder() {
+    if (!audio_decoder_.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock{audio_decoder_mutex_};
+        audio_decoder_stop_ = true;
+    }
+    audio_decoder_cv_.notify_one();
+
+    audio_decoder_.join();
+}
+
+void application::update_texture_format() {
+    if (requested_chunk_size_ == chunk_size_ && requested_encoding_ == encoding_
+            && requested_frequency_scale_ == frequency_scale_ && requested_decimation_ == decimation_
+            && get_texture_layers() == texture_layers_)
+        return;
+
+    // texture width depends on the chunk size and the frequency scale, its format on the encoding and its layers
+    // on the channels of the file and the mid/side option, re-create texture and everything referencing it (also
+    // when changing the decimation, as the existing rows cover a different frequency range)
+    get_device().wait_idle();
+
+    auto const decimation_changed = requested_decimation_ != decimation_;
+
+    chunk_size_      = requested_chunk_size_;
+    encoding_        = requested_encoding_;
+    frequency_scale_ = requested_frequency_scale_;
+    decimation_      = requested_decimation_;
+    if (chunk_size_ != default_chunk_size)
+        audio_fft_dynamic_.assign(audio_workers_.size(), audio::dynamic_fft_plan<float>{chunk_size_});
+
+    auto const sample_rate = get_sample_rate();
+    if (frequency_scale_ == audio::frequency_scale::constant_q) {
+        audio_cqt_ = audio::constant_q_transform<float>{chunk_size_, sample_rate, cqt_bins_per_octave, cqt_f_min,
+                cqt_f_max};
+    } else if (frequency_scale_ == audio::frequency_scale::multires) {
+        audio_multires_.assign(audio_workers_.size(), audio::multires_plan<float>{
+                chunk_size_ / multires_size_divisor, multires_levels});
+    } else if (frequency_scale_ != audio::frequency_scale::linear) {
+        audio_filterbank_ = audio::filterbank<float>{chunk_size_, sample_rate, filterbank_bands, frequency_scale_,
+                filterbank_f_min, std::min(filterbank_f_max, sample_rate / 2.0)};
+    }
+
+    audio_sdft_.assign(get_texture_layers(), make_sliding_dft(chunk_size_));
+    if (decimation_changed)
+        reset_decimation();
+
+    setup_row_buffers();
+    setup_feature_extractors();
+    apply_magnitude_mode();
+
+    texture_offset_ = 0;
+
+    setup_texture();
+    setup_command_buffers();
+}
+
+void application::apply_magnitude_mode() noexcept {
+    for (auto& plan : audio_fft_)
+        plan.set_magnitude_mode(magnitude_mode_);
+
+    for (auto& plan : audio_fft_dynamic_)
+        plan.set_magnitude_mode(magnitude_mode_);
+
+    for (auto& sdft : audio_sdft_)
+        sdft.set_magnitude_mode(magnitude_mode_);
+
+    for (auto& plan : audio_multires_)
+        plan.set_magnitude_mode(magnitude_mode_);
+
+    for (auto& extractor : audio_features_)
+        extractor.set_magnitude_mode(magnitude_mode_);
+
+    audio_cqt_.set_magnitude_mode(magnitude_mode_);
+}
+
+void application::toggle_sliding_dft_mode() noexcept {
+    if (!supports_sliding_dft(requested_frequency_scale_))
+        return;
+
+    sliding_dft_mode_ = !sliding_dft_mode_;
+
+    // the history is stale after running in FFT mode
+    for (auto& sdft : audio_sdft_)
+        sdft.reset();
+}
+
+void application::toggle_mid_side() {
+    auto const channels = static_cast<std::size_t>(audio_in_fmt_.channels);
+    if (channels < 2)
+        return;
+
+    mid_side_ = !mid_side_;
+
+    // the decimated samples are not derived, all layers restart with empty decimation filters
+    reset_decimation();
+
+    if (!mid_side_) {
+        audio_imgbuf_.resize(channels);
+        return;
+    }
+
+    // derive the already buffered samples from the first two channels, keeping all image buffers in sync
+    auto const left  = audio_imgbuf_[0].data();
+    auto const right = audio_imgbuf_[1].data();
+    auto const count = audio_imgbuf_[0].size();
+
+    auto mid  = utils::contiguous_fifo<float>(audio_imgbuf_[0].capacity());
+    auto side = utils::contiguous_fifo<float>(audio_imgbuf_[0].capacity());
+    auto const mid_dst  = mid.append(count);
+    auto const side_dst = side.append(count);
+
+    for (std::size_t i = 0; i < count; i++) {
+        mid_dst[i]  = (left[i] + right[i]) * 0.5f;
+        side_dst[i] = (left[i] - right[i]) * 0.5f;
+    }
+
+    audio_imgbuf_.push_back(std::move(mid));
+    audio_imgbuf_.push_back(std::move(side));
+}
+
+auto application::get_texture_layers() const noexcept -> std::uint32_t {
+    return static_cast<std::uint32_t>(audio_in_fmt_.channels + (mid_side_ ? mid_side_layers : 0));
+}
+
+void application::reset_decimation() {
+    audio_decbuf_.clear();
+    audio_decimator_.clear();
+
+    if (decimation_ == 1)
+        return;
+
+    for (std::size_t layer = 0; layer < get_texture_layers(); layer++) {
+        audio_decbuf_.emplace_back(audio_imgbuf_.front().capacity());
+        audio_decimator_.emplace_back(decimation_);
+    }
+}
+
+// sample rate of the analysed signal, after decimation
+auto application::get_sample_rate() const noexcept -> double {
+    return static_cast<double>(audio_in_fmt_.sample_rate) / decimation_;
+}
+
+void application::setup_row_buffers() {
+    auto const bands = std::max<std::size_t>(filterbank_bands, audio_cqt_.output_size());
+
+    audio_rowbuf_.assign(audio_workers_.size(), utils::aligned_buffer<float>{
+            get_texture_layers() * get_row_size() + bands});
+    audio_specbuf_.assign(audio_workers_.size(), utils::aligned_buffer<std::complex<float>>{
+            audio::rfft_output_size(chunk_size_)});
+}
+
+void application::setup_feature_extractors() {
+    audio_features_.assign(audio_workers_.size() * get_texture_layers(), audio::feature_extractor<float>{
+            chunk_size_, get_sample_rate()});
+    audio_feature_rows_.resize(chunks * get_texture_layers());
+}
+
+auto application::get_feature_queue() noexcept -> boost::lockfree::spsc_queue<feature_record>& {
+    return audio_feature_queue_;
+}
+
+// samples per analysis window: the chunk size, or the frame covering all levels of the multi-resolution plan
+auto application::get_window_size() const noexcept -> std::size_t {
+    if (frequency_scale_ == audio::frequency_scale::multires)
+        return audio_multires_.front().input_size();
+
+    return chunk_size_;
+}
+
+// values per row and layer written by the transform, before any rebinning
+auto application::get_row_size() const noexcept -> std::size_t {
+    if (frequency_scale_ == audio::frequency_scale::multires)
+        return audio_multires_.front().output_size();
+
+    return audio::rfft_output_size(chunk_size_);
+}
+
+auto application::get_texture_extent() const noexcept -> VkExtent3D {
+    auto width = static_cast<std::size_t>(filterbank_bands);
+    if (frequency_scale_ == audio::frequency_scale::linear || frequency_scale_ == audio::frequency_scale::multires)
+        width = get_row_size();
+    else if (frequency_scale_ == audio::frequency_scale::constant_q)
+        width = audio_cqt_.output_size();
+
+    return {static_cast<std::uint32_t>(width), chunks, 1};
 }
 
 void application::frame_draw() {
-    // update texture-image
-    if (!paused_) {
+    update_texture_format();
+
+    // update texture-image, while paused no new rows are added but the display uniforms are still updated
+    {
         auto const device = get_device().get_handle();
         auto const fence  = staging_fence_.get_handle();
 
@@ -854,13 +1251,45 @@ void application::frame_draw() {
         auto range = std::vector<std::tuple<std::int32_t, std::uint32_t>>();
 
         // Note: this is a primitive synchronization, due to some issues with portaudio's Pa_GetStreamTime(...)
-        auto frames_to_display = audio_samples_written_ - audio_samples_displayed_;
-        new_chunks = std::min(frames_to_display, static_cast<std::int64_t>(audio_imgbuf_.size())) / chunk_size;
-        audio_samples_displayed_ += new_chunks * chunk_size;
+        // FFT mode: the image buffer starts at the next analysis window, windows start every hop samples. Samples
+        // are only dropped from the buffer once no further window overlaps them.
+        // Sliding DFT mode: the image buffer starts at the next sample, the sliding DFT keeps its own history.
+        // Decimation: all samples due for display are moved through the decimation filters, the buffers of the
+        // decimated samples take the place of the image buffers. Window and hop are counted in decimated samples.
+        auto frames_to_display = paused_ ? 0 : audio_samples_written_ - audio_samples_displayed_;
+        auto const chunk_size  = static_cast<std::int64_t>(chunk_size_);
+        auto const window_size = static_cast<std::int64_t>(get_window_size());
+        auto const sliding = sliding_dft_mode_;
+        auto const hop = sliding
+                ? static_cast<std::int64_t>(sliding_dft_hop)
+                : std::max<std::int64_t>(chunk_size / selectable_overlaps[overlap_index_], 1);
+        auto frames_available = std::min(frames_to_display, static_cast<std::int64_t>(audio_imgbuf_[0].size()));
+
+        if (decimation_ > 1) {
+            for (std::size_t layer = 0; layer < audio_imgbuf_.size(); layer++) {
+                audio_decimator_[layer].process(audio_imgbuf_[layer].data(), frames_available,
+                        std::back_inserter(audio_decbuf_[layer]));
+                audio_imgbuf_[layer].erase_begin(frames_available);
+            }
+
+            audio_samples_displayed_ += frames_available;
+            frames_available = static_cast<std::int64_t>(audio_decbuf_[0].size());
+        }
+
+        auto& analysis_buffers = decimation_ > 1 ? audio_decbuf_ : audio_imgbuf_;
+
+        if (sliding)
+            new_chunks = frames_available / hop;
+        else
+            new_chunks = frames_available >= window_size ? (frames_available - window_size) / hop + 1 : 0;
+
+        new_chunks = std::min<std::int64_t>(new_chunks, chunks);
+        if (decimation_ == 1)
+            audio_samples_displayed_ += new_chunks * hop;
 
         if (new_chunks == 0) {
             range = {};
-        } else if (texture_offset_ + new_chunks < chunks) {
+        } else if (texture_offset_ + new_chunks <= chunks) {
             range = {{texture_offset_, new_chunks}};
         } else {
             range = {
@@ -869,30 +1298,192 @@ void application::frame_draw() {
             };
         }
 
-        // update texture image
-        auto const chunk_bytes = chunk_size * 4;
-        for (auto const& r : range) {
-            auto const num_chunks   = std::get<1>(r);
-            auto const offset_bytes = std::get<0>(r) * chunk_bytes;
-            auto const len_bytes    = num_chunks * chunk_bytes;
+        // update texture image: transform all new chunks into the mapped staging buffer, large batches (e.g. when
+        // catching up after a stall) are split across the worker pool, each worker writing its own rows
+        void* staging = nullptr;
+        if (new_chunks > 0)
+            staging = texture_staging_buffer_.map_memory(device, 0, VK_WHOLE_SIZE, 0).move_or_throw();
+
+        // unmap the staging buffer if anything below throws
+        auto const staging_guard = utils::on_scope_exit([&]() {
+            if (staging != nullptr)
+                texture_staging_buffer_.unmap_memory(device);
+        });
+
+        // rows starting at the given chunk for all layers, the FFT transforms the layers pairwise using one
+        // complex FFT per pair
+        auto const transform_rows = [this, &analysis_buffers, hop](std::size_t worker, std::int64_t chunk,
+                float* const* dst, std::int64_t num, std::ptrdiff_t stride) {
+            auto src = std::vector<float const*>();
+            for (auto const& buffer : analysis_buffers)
+                src.push_back(buffer.data() + chunk * hop);
+
+            if (sliding_dft_mode_) {
+                for (std::size_t layer = 0; layer < src.size(); layer++)
+                    audio_sdft_[layer].execute_batch(src[layer], dst[layer], num, stride, hop);
+            } else if (frequency_scale_ == audio::frequency_scale::multires) {
+                for (std::size_t layer = 0; layer < src.size(); layer++)
+                    audio_multires_[worker].execute_batch(src[layer], dst[layer], num, stride, hop);
+            } else if (chunk_size_ == default_chunk_size) {
+                audio_fft_[worker].execute_multichannel_batch(src.data(), dst, src.size(), num, stride, hop);
+            } else {
+                audio_fft_dynamic_[worker].execute_multichannel_batch(src.data(), dst, src.size(), num, stride,
+                        hop);
+            }
+        };
+
+        // complex spectrum of the given layer for the constant-Q transform, always computed using the FFT
+        auto const transform_spectrum = [this, &analysis_buffers, hop](std::size_t worker, std::int64_t chunk,
+                std::size_t layer, std::complex<float>* dst) {
+            auto const src = analysis_buffers[layer].data() + chunk * hop;
+
+            if (chunk_size_ == default_chunk_size)
+                audio_fft_[worker].execute_spectrum(src, dst);
+            else
+                audio_fft_dynamic_[worker].execute_spectrum(src, dst);
+        };
+
+        // power spectrum: 20 log10(|X|^2) is twice the level in dB, scale the range to get the same mapping
+        auto const power = magnitude_mode_ == audio::magnitude_mode::power;
+        auto const db_range = power
+                ? audio::db_range{2.0f * spectrum_db_range.min, 2.0f * spectrum_db_range.max}
+                : spectrum_db_range;
+
+        // spectral features are extracted from the row buffers, while the magnitudes are still in cache
+        auto const features = features_enabled_ && !sliding && supports_features(frequency_scale_);
+
+        auto const transform = [&, staging](std::size_t worker, std::int64_t first, std::int64_t last) {
+            auto const width  = get_row_size();
+            auto const layers = audio_imgbuf_.size();
+            auto const scale  = frequency_scale_;
+            auto const rebin  = scale != audio::frequency_scale::linear && scale != audio::frequency_scale::multires;
+            auto const bands  = audio_rowbuf_[worker].data() + layers * width;
+            auto dst = std::vector<float*>(layers);
+
+            auto const extractor = [&](std::size_t layer) -> audio::feature_extractor<float>& {
+                return audio_features_[worker * layers + layer];
+            };
 
-            void* data = texture_staging_image_.map_memory(device, offset_bytes, len_bytes, 0).move_or_throw();
+            // the flux of the first row refers to the row before it: worker 0 continues from the previous frame,
+            // all other workers recompute the last row of the preceding worker
+            if (features && first > 0 && first < last) {
+                for (std::size_t layer = 0; layer < layers; layer++)
+                    dst[layer] = audio_rowbuf_[worker].data() + layer * width;
 
-            for (int i = 0; i < num_chunks; i++) {
-                auto const src = audio_imgbuf_.begin() + chunk_size * i;
-                auto const dst = static_cast<float*>(data) + chunk_size * i;
+                transform_rows(worker, first - 1, dst.data(), 1, 0);
 
-                audio::rfft<chunk_size>(src, dst);
+                for (std::size_t layer = 0; layer < layers; layer++)
+                    extractor(layer).set_reference(dst[layer]);
             }
 
-            audio_imgbuf_.erase_begin(chunk_size * num_chunks);
-            texture_staging_image_.unmap_memory(device);
+            // split at the texture wrap-around
+            while (first < last) {
+                auto const row = (texture_offset_ + first) % chunks;
+                auto const num = std::min<std::int64_t>(last - first, chunks - row);
+
+                // the layers follow each other in the staging buffer
+                auto const dst_row = [&](std::size_t layer) {
+                    return static_cast<std::uint8_t*>(staging) + (layer * chunks + row) * texture_row_pitch_;
+                };
+
+                if (encoding_ == audio::spectrum_encoding::linear_f32 && !rebin && !features) {
+                    // write magnitudes directly
+                    for (std::size_t layer = 0; layer < layers; layer++)
+                        dst[layer] = reinterpret_cast<float*>(dst_row(layer));
+
+                    auto const stride = static_cast<std::ptrdiff_t>(texture_row_pitch_ / sizeof(float));
+                    transform_rows(worker, first, dst.data(), num, stride);
+                } else {
+                    // transform into the row buffers of this worker, extract the features, rebin (or apply the
+                    // constant-Q kernel) and encode into the staging buffer
+                    for (std::size_t layer = 0; layer < layers; layer++)
+                        dst[layer] = audio_rowbuf_[worker].data() + layer * width;
+
+                    for (std::int64_t i = 0; i < num; i++) {
+                        auto const offset = i * texture_row_pitch_;
+
+                        if (scale != audio::frequency_scale::constant_q)
+                            transform_rows(worker, first + i, dst.data(), 1, 0);
+
+                        for (std::size_t layer = 0; layer < layers; layer++) {
+                            if (features) {
+                                auto const index = first + i;
+                                audio_feature_rows_[index * layers + layer] = feature_record{audio_feature_row_ + index,
+                                        static_cast<std::uint32_t>(layer), extractor(layer).apply(dst[layer])};
+                            }
+
+                            if (scale == audio::frequency_scale::constant_q) {
+                                auto const spectrum = audio_specbuf_[worker].data();
+
+                                transform_spectrum(worker, first + i, layer, spectrum);
+                                audio_cqt_.apply(spectrum, bands);
+                                audio::encode_spectrum(bands, dst_row(layer) + offset, audio_cqt_.output_size(),
+                                        encoding_, db_range);
+                            } else if (rebin) {
+                                audio_filterbank_.apply(dst[layer], bands);
+                                audio::encode_spectrum(bands, dst_row(layer) + offset, filterbank_bands, encoding_,
+                                        db_range);
+                            } else {
+                                audio::encode_spectrum(dst[layer], dst_row(layer) + offset, width, encoding_,
+                                        db_range);
+                            }
+                        }
+                    }
+                }
+
+                first += num;
+            }
+        };
+
+        // the sliding DFT is a sequential recurrence and always runs on this thread
+        auto const parallel = !sliding && new_chunks >= parallel_chunk_threshold;
+        if (parallel) {
+            audio_workers_.dispatch([&transform, new_chunks](std::size_t worker, std::size_t num_workers) {
+                auto const first = new_chunks * static_cast<std::int64_t>(worker) / num_workers;
+                auto const last  = new_chunks * static_cast<std::int64_t>(worker + 1) / num_workers;
+                transform(worker, first, last);
+            });
+        } else {
+            transform(0, 0, new_chunks);
         }
 
-        // update uniform buffer
-        if (new_chunks > 0) {
-            void* data = uniform_staging_buffer_.map_memory(device, 0, sizeof(std::int32_t), 0).move_or_throw();
-            *static_cast<std::int32_t*>(data) = texture_offset_ + new_chunks;
+        // the job references transform and the workers write into the staging buffer: if anything below throws,
+        // wait for them before unwinding (their own error is superseded by the one in flight)
+        auto const workers_guard = utils::on_scope_exit([&]() {
+            if (!parallel)
+                return;
+
+            try {
+                audio_workers_.join();
+            } catch (...) {}
+        });
+
+        // update uniform buffer, every frame: view, layer, scale and mode may change independently of new rows
+        {
+            auto uniforms = texture_uniforms{};
+            uniforms.offset = texture_offset_ + new_chunks;
+            uniforms.mode   = encoding_ != audio::spectrum_encoding::linear_f32 ? 1 : power ? 2 : 0;
+            uniforms.db_min = spectrum_db_range.min;
+            uniforms.db_max = spectrum_db_range.max;
+            uniforms.view   = static_cast<std::int32_t>(layer_view_);
+            uniforms.layer  = static_cast<std::int32_t>(selected_layer_);
+            uniforms.channels = audio_in_fmt_.channels;
+
+            // the linear scale shows the lower part of the spectrum (up to the alias-free part of the band when
+            // decimating), the multi-resolution scale everything below its undecimated level, the bands cover the
+            // whole texture
+            uniforms.xview_begin = 1.0f;
+            uniforms.xview_end   = 0.0f;
+
+            if (frequency_scale_ == audio::frequency_scale::linear) {
+                uniforms.xview_begin = std::min(0.2f * decimation_, 0.75f);
+            } else if (frequency_scale_ == audio::frequency_scale::multires) {
+                auto const& plan = audio_multires_.front();
+                uniforms.xview_begin = static_cast<float>(plan.level_offset(0)) / plan.output_size();
+            }
+
+            void* data = uniform_staging_buffer_.map_memory(device, 0, sizeof(texture_uniforms), 0).move_or_throw();
+            std::memcpy(data, &uniforms, sizeof(texture_uniforms));
             uniform_staging_buffer_.unmap_memory(device);
         }
 
@@ -900,6 +1491,32 @@ void application::frame_draw() {
         {
             setup_transfer_cmdbuffer(range);
 
+            // wait for the transforms to finish before submitting the transfer
+            if (parallel)
+                audio_workers_.join();
+
+            // publish the features in row order (this thread is the only producer), worker 0 continues from the
+            // last row of this frame
+            if (features && new_chunks > 0) {
+                auto const layers = audio_imgbuf_.size();
+
+                if (parallel) {
+                    auto const last = (audio_workers_.size() - 1) * layers;
+                    for (std::size_t layer = 0; layer < layers; layer++)
+                        std::swap(audio_features_[layer], audio_features_[last + layer]);
+                }
+
+                audio_feature_queue_.push(audio_feature_rows_.data(), new_chunks * layers);
+            }
+
+            if (new_chunks > 0) {
+                for (auto& buffer : analysis_buffers)
+                    buffer.erase_begin(hop * new_chunks);
+
+                texture_staging_buffer_.unmap_memory(device);
+                staging = nullptr;
+            }
+
             auto command_buffer = transfer_cmdbuffer_.get_handle();
 
             auto submit_info = VkSubmitInfo{};
@@ -910,9 +1527,10 @@ void application::frame_draw() {
             vulkan::except(get_device().get_graphics_queue().submit(1, &submit_info, fence));
         }
 
-        texture_offset_ += new_chunks;
-        if (texture_offset_ >= texture_extent.height)
-            texture_offset_ -= texture_extent.height;
+        audio_feature_row_ += new_chunks;
+        texture_offset_    += new_chunks;
+        if (texture_offset_ >= chunks)
+            texture_offset_ -= chunks;
     }
 
     // render texture to screen
@@ -968,6 +1586,38 @@ void application::cb_input_key(int key, int scancode, int action, int mods) noex
         window().set_terminate_request(true);
     else if (key == GLFW_KEY_SPACE && action == GLFW_PRESS)
         paused_ = !paused_;
+    else if (key >= GLFW_KEY_1 && key < GLFW_KEY_1 + static_cast<int>(selectable_chunk_sizes.size()) && action == GLFW_PRESS)
+        requested_chunk_size_ = selectable_chunk_sizes[key - GLFW_KEY_1];
+    else if (key == GLFW_KEY_O && action == GLFW_PRESS)
+        overlap_index_ = (overlap_index_ + 1) % selectable_overlaps.size();
+    else if (key == GLFW_KEY_S && action == GLFW_PRESS)
+        toggle_sliding_dft_mode();
+    else if (key == GLFW_KEY_E && action == GLFW_PRESS) {
+        features_enabled_ = !features_enabled_;
+
+        // the reference spectra are stale
+        for (auto& extractor : audio_features_)
+            extractor.reset();
+    } else if (key == GLFW_KEY_Z && action == GLFW_PRESS)
+        requested_decimation_ = next_decimation(requested_decimation_);
+    else if (key == GLFW_KEY_D && action == GLFW_PRESS)
+        requested_encoding_ = next_spectrum_encoding(requested_encoding_);
+    else if (key == GLFW_KEY_F && action == GLFW_PRESS) {
+        requested_frequency_scale_ = next_frequency_scale(requested_frequency_scale_);
+
+        while (sliding_dft_mode_ && !supports_sliding_dft(requested_frequency_scale_))
+            requested_frequency_scale_ = next_frequency_scale(requested_frequency_scale_);
+    } else if (key == GLFW_KEY_M && action == GLFW_PRESS) {
+        magnitude_mode_ = next_magnitude_mode(magnitude_mode_);
+        apply_magnitude_mode();
+    } else if (key == GLFW_KEY_V && action == GLFW_PRESS)
+        layer_view_ = next_layer_view(layer_view_);
+    else if (key == GLFW_KEY_L && action == GLFW_PRESS)
+        selected_layer_ = (selected_layer_ + 1) % get_texture_layers();
+    else if (key == GLFW_KEY_X && action == GLFW_PRESS) {
+        toggle_mid_side();
+        selected_layer_ = std::min(selected_layer_, get_texture_layers() - 1);
+    }
 }
 
 auto application::select_physical_device(std::vector<VkPhysicalDevice> const& devices) const -> VkPhysicalDevice {
@@ -1,12 +1,38 @@
 #include <avis/application.hpp>
+#include <avis/offline.hpp>
 #include <avis/glfw/initializer.hpp>
 
+#include <exception>
 #include <iostream>
+#include <string>
 
 
+static auto render_offline(std::string const& input, std::string const& output) -> int {
+    av_register_all();
+
+    try {
+        avis::offline_renderer renderer{avis::audio_out_fmt, avis::default_chunk_size, avis::default_chunk_size};
+        auto const stats = renderer.render(input, output);
+
+        auto const rate = stats.seconds > 0.0 ? stats.frames / stats.seconds : 0.0;
+        std::cout << stats.rows << " rows from " << stats.frames << " samples per channel in " << stats.seconds
+                  << " s: " << rate << " samples per second (" << rate / avis::audio_out_fmt.sample_rate
+                  << "x real time)\n";
+    } catch (std::exception const& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
+
 int main(int argc, char** argv) {
+    if (argc == 5 && std::string{argv[1]} == "--offline" && std::string{argv[3]} == "--out")
+        return render_offline(argv[2], argv[4]);
+
     if (argc != 2) {
-        std::cout << "Usage: " << argv[0] << " <filename>\n";
+        std::cout << "Usage: " << argv[0] << " <filename>\n"
+                  << "       " << argv[0] << " --offline <filename> --out <spectrogram>\n";
         return 1;
     }
 
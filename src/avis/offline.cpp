@@ -0,0 +1,329 @@
+#include <avis/offline.hpp>
+#include <avis/audio/channels.hpp>
+#include <avis/utils/scope_exit.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+
+namespace avis {
+
+// decoded frames per block, the rows of one block are transformed while the next one is decoded
+constexpr auto offline_block_frames = 1024 * 64L;
+
+// minimum length of the segments decoded in parallel, shorter files are decoded sequentially
+constexpr auto offline_min_segment_seconds = 30.0;
+
+// samples decoded and discarded before each segment, priming decoder and resampler after seeking
+constexpr auto offline_preroll_seconds = 0.25;
+
+
+offline_renderer::offline_renderer(audio::ffmpeg::stream_format const& format, std::size_t window, std::size_t hop,
+        std::size_t workers)
+        : format_{format}
+        , window_{window}
+        , hop_{hop}
+        , workers_{workers}
+        , plans_(workers_.size(), audio::dynamic_fft_plan<float>{window})
+        , readbuf_{}
+        , planes_{}
+        , rows_{}
+{
+    if (hop == 0)
+        throw std::invalid_argument("The offline renderer requires a hop size of at least one!");
+
+    if (format.sample_format != AV_SAMPLE_FMT_FLT)
+        throw std::invalid_argument("The offline renderer requires 32 bit float samples!");
+}
+
+auto offline_renderer::render(std::string const& input, std::string const& output) -> statistics {
+    auto const start = std::chrono::steady_clock::now();
+
+    auto const stream   = audio::ffmpeg::audio_input_stream::open_native(format_, input);
+    auto const fmt      = stream.get_format();
+    auto const duration = stream.duration();
+    auto const segments = static_cast<std::int64_t>(workers_.size());
+    auto const min_segment = static_cast<std::int64_t>(offline_min_segment_seconds * fmt.sample_rate);
+
+    // segments ending early (the duration reported by the container is too large) would leave gaps in the file,
+    // render sequentially in that case
+    auto stats = statistics{0, 0, segments, 0.0};
+    if (segments < 2 || duration < segments * min_segment || !render_segmented(input, output, fmt, duration, stats))
+        stats = render_sequential(input, output);
+
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+auto offline_renderer::make_header(audio::ffmpeg::stream_format const& fmt, std::int64_t rows) const
+        -> spectrogram_header
+{
+    return {{'A', 'V', 'S', 'P'}, static_cast<std::uint32_t>(fmt.channels),
+            static_cast<std::uint32_t>(audio::rfft_output_size(window_)), static_cast<std::uint32_t>(window_),
+            static_cast<std::uint32_t>(hop_), static_cast<std::uint32_t>(fmt.sample_rate),
+            static_cast<std::uint64_t>(rows)};
+}
+
+auto offline_renderer::render_sequential(std::string const& input, std::string const& output) -> statistics {
+    auto stream = audio::ffmpeg::audio_input_stream::open_native(format_, input);
+    auto const fmt         = stream.get_format();
+    auto const channels    = static_cast<std::size_t>(fmt.channels);
+    auto const sample_size = audio::ffmpeg::get_pcm_sample_size(fmt);
+    auto const bins        = audio::rfft_output_size(window_);
+
+    // rows of one block, plus the rows of the samples carried over from the previous block
+    auto const max_rows = static_cast<std::size_t>(offline_block_frames) / hop_ + window_ / hop_ + 1;
+
+    readbuf_ = std::vector<std::uint8_t>(sample_size * offline_block_frames);
+    planes_.assign(channels, std::vector<float>{});
+    rows_    = utils::aligned_buffer<float>{max_rows * channels * bins};
+
+    auto file = std::ofstream();
+    file.exceptions(std::ios::failbit | std::ios::badbit);
+    file.open(output, std::ios::binary | std::ios::trunc);
+
+    // the number of rows is updated once everything is written
+    auto header = make_header(fmt, 0);
+    file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+
+    auto stats = statistics{0, 0, 1, 0.0};
+
+    while (true) {
+        // transform all complete windows buffered so far on the worker pool
+        auto const available = planes_.front().size();
+        auto const num_rows  = available >= window_ ? (available - window_) / hop_ + 1 : 0;
+
+        if (num_rows > 0) {
+            workers_.dispatch([&](std::size_t worker, std::size_t num_workers) {
+                auto const first = num_rows * worker / num_workers;
+                auto const last  = num_rows * (worker + 1) / num_workers;
+                if (first == last)
+                    return;
+
+                // rows of all layers follow each other
+                auto worker_src = std::vector<float const*>(channels);
+                auto worker_dst = std::vector<float*>(channels);
+                for (std::size_t c = 0; c < channels; c++) {
+                    worker_src[c] = planes_[c].data() + first * hop_;
+                    worker_dst[c] = rows_.data() + (first * channels + c) * bins;
+                }
+
+                auto const stride = static_cast<std::ptrdiff_t>(channels * bins);
+                plans_[worker].execute_multichannel_batch(worker_src.data(), worker_dst.data(), channels,
+                        last - first, stride, hop_);
+            });
+        }
+
+        // the job references the locals of this iteration, wait for the workers if decoding or writing throws
+        auto const workers_guard = utils::on_scope_exit([&]() {
+            if (num_rows == 0)
+                return;
+
+            try {
+                workers_.join();
+            } catch (...) {}
+        });
+
+        // decode the next block while the workers are busy, the planes are not modified until they are done
+        auto const len = stream.eof() ? 0 : stream.read(readbuf_.data(), static_cast<int>(offline_block_frames));
+        stats.frames += len;
+
+        if (num_rows > 0) {
+            workers_.join();
+
+            file.write(reinterpret_cast<char const*>(rows_.data()), num_rows * channels * bins * sizeof(float));
+            stats.rows += num_rows;
+
+            // drop the samples no further window overlaps
+            for (auto& plane : planes_)
+                plane.erase(plane.begin(), plane.begin() + num_rows * hop_);
+        }
+
+        if (len == 0 && stream.eof())
+            break;
+
+        // append the decoded block to the planes
+        auto dst = std::vector<float*>(channels);
+        for (std::size_t c = 0; c < channels; c++) {
+            planes_[c].resize(planes_[c].size() + len);
+            dst[c] = planes_[c].data() + planes_[c].size() - len;
+        }
+
+        audio::deinterleave(reinterpret_cast<float const*>(readbuf_.data()), len, channels, dst.data());
+    }
+
+    header.rows = static_cast<std::uint64_t>(stats.rows);
+    file.seekp(0);
+    file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    file.close();
+
+    return stats;
+}
+
+auto offline_renderer::render_segmented(std::string const& input, std::string const& output,
+        audio::ffmpeg::stream_format const& fmt, std::int64_t duration, statistics& stats) -> bool
+{
+    // rows expected from the reported duration, split evenly, the last segment continues to the end of the stream
+    auto const window   = static_cast<std::int64_t>(window_);
+    auto const hop      = static_cast<std::int64_t>(hop_);
+    auto const rows     = duration >= window ? (duration - window) / hop + 1 : 0;
+    auto const segments = static_cast<std::int64_t>(workers_.size());
+
+    // the header is written first, the segments write their rows to their final position in the file
+    {
+        auto file = std::ofstream();
+        file.exceptions(std::ios::failbit | std::ios::badbit);
+        file.open(output, std::ios::binary | std::ios::trunc);
+
+        auto const header = make_header(fmt, 0);
+        file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    }
+
+    auto results = std::vector<segment_result>(workers_.size());
+
+    workers_.dispatch([&](std::size_t worker, std::size_t) {
+        auto const segment   = static_cast<std::int64_t>(worker);
+        auto const first_row = rows * segment / segments;
+        auto const last_row  = segment + 1 < segments
+                ? rows * (segment + 1) / segments
+                : std::numeric_limits<std::int64_t>::max();
+
+        // a failing segment (seeking, decoding near the seek point, writing) is incomplete, the file is then
+        // rendered sequentially
+        try {
+            results[worker] = render_segment(input, output, worker, first_row, last_row);
+        } catch (...) {
+            results[worker] = {0, 0, false};
+        }
+    });
+    workers_.join();
+
+    if (!std::all_of(results.begin(), results.end(), [](auto const& r) { return r.complete; }))
+        return false;
+
+    // the segments before the last one must cover exactly the rows up to the last segment without gaps, the last
+    // one continues to the actual end of the stream: it may end one row early or late (the reported duration is
+    // rounded), anything else means the duration is off and the segments are not trusted to be aligned
+    auto const last_rows = rows - rows * (segments - 1) / segments;
+
+    stats.rows = 0;
+    for (std::size_t i = 0; i + 1 < results.size(); i++)
+        stats.rows += results[i].rows;
+
+    if (stats.rows != rows * (segments - 1) / segments)
+        return false;
+
+    if (results.back().rows < last_rows - 1 || results.back().rows > last_rows + 1)
+        return false;
+
+    stats.rows += results.back().rows;
+
+    stats.frames = results.back().end;
+
+    auto file = std::fstream();
+    file.exceptions(std::ios::failbit | std::ios::badbit);
+    file.open(output, std::ios::binary | std::ios::in | std::ios::out);
+
+    auto const header = make_header(fmt, stats.rows);
+    file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+
+    return true;
+}
+
+auto offline_renderer::render_segment(std::string const& input, std::string const& output, std::size_t worker,
+        std::int64_t first_row, std::int64_t last_row) -> segment_result
+{
+    auto stream = audio::ffmpeg::audio_input_stream::open_native(format_, input);
+    auto const fmt         = stream.get_format();
+    auto const channels    = static_cast<std::size_t>(fmt.channels);
+    auto const sample_size = audio::ffmpeg::get_pcm_sample_size(fmt);
+    auto const bins        = audio::rfft_output_size(window_);
+    auto const row_bytes   = static_cast<std::int64_t>(channels * bins * sizeof(float));
+    auto const max_rows    = static_cast<std::size_t>(offline_block_frames) / hop_ + window_ / hop_ + 1;
+
+    auto readbuf = std::vector<std::uint8_t>(sample_size * offline_block_frames);
+    auto planes  = std::vector<std::vector<float>>(channels);
+    auto rows    = utils::aligned_buffer<float>{max_rows * channels * bins};
+
+    auto const start   = first_row * static_cast<std::int64_t>(hop_);
+    auto const preroll = static_cast<std::int64_t>(offline_preroll_seconds * fmt.sample_rate);
+
+    // seek shortly before the segment, seek points may be coarser than requested: if decoding starts after the
+    // segment, seek further back
+    auto len      = 0;
+    auto position = std::int64_t{0};       // of the first sample in the read buffer, the planes start at the segment
+
+    for (auto distance = preroll; ; distance *= 4) {
+        auto const target = std::max<std::int64_t>(start - distance, 0);
+        if (start > 0)
+            stream.seek(target);
+
+        len      = stream.read(readbuf.data(), static_cast<int>(offline_block_frames));
+        position = stream.position() - len;
+
+        if (position <= start || target == 0)
+            break;
+    }
+
+    if (position > start)
+        return {0, stream.position(), false};
+
+    auto file = std::ofstream();
+    file.exceptions(std::ios::failbit | std::ios::badbit);
+    file.open(output, std::ios::binary | std::ios::in | std::ios::out);
+
+    auto row = first_row;
+    auto src = std::vector<float const*>(channels);
+    auto dst = std::vector<float*>(channels);
+
+    while (true) {
+        // append the decoded block to the planes, dropping the samples before the segment
+        auto const skip = static_cast<int>(std::min<std::int64_t>(std::max<std::int64_t>(start - position, 0), len));
+        auto const count = len - skip;
+
+        for (std::size_t c = 0; c < channels; c++) {
+            planes[c].resize(planes[c].size() + count);
+            dst[c] = planes[c].data() + planes[c].size() - count;
+        }
+
+        audio::deinterleave(reinterpret_cast<float const*>(readbuf.data()) + skip * channels, count, channels,
+                dst.data());
+
+        // transform the complete windows of this segment, the planes start at the window of the next row
+        auto const available = planes.front().size();
+        auto num_rows = available >= window_ ? static_cast<std::int64_t>((available - window_) / hop_ + 1) : 0;
+        num_rows = std::min(num_rows, last_row - row);
+
+        if (num_rows > 0) {
+            for (std::size_t c = 0; c < channels; c++) {
+                src[c] = planes[c].data();
+                dst[c] = rows.data() + c * bins;
+            }
+
+            plans_[worker].execute_multichannel_batch(src.data(), dst.data(), channels, num_rows,
+                    static_cast<std::ptrdiff_t>(channels * bins), hop_);
+
+            file.seekp(sizeof(spectrogram_header) + row * row_bytes);
+            file.write(reinterpret_cast<char const*>(rows.data()), num_rows * row_bytes);
+            row += num_rows;
+
+            for (auto& plane : planes)
+                plane.erase(plane.begin(), plane.begin() + num_rows * hop_);
+        }
+
+        if (row == last_row || stream.eof())
+            break;
+
+        position = stream.position();
+        len      = stream.read(readbuf.data(), static_cast<int>(offline_block_frames));
+    }
+
+    // the last segment is complete at the end of the stream
+    auto const complete = row == last_row || last_row == std::numeric_limits<std::int64_t>::max();
+    return {row - first_row, stream.position(), complete};
+}
+
+} /* namespace avis */
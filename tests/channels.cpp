@@ -0,0 +1,117 @@
+#include "reference.hpp"
+
+#include <avis/audio/channels.hpp>
+#include <avis/utils/cpu.hpp>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace avis;
+using namespace avis::audio;
+using namespace avis::test;
+
+
+// frame counts around the vector widths, including remainders
+constexpr std::size_t frame_counts[] = {1, 7, 8, 15, 16, 17, 31, 33, 1001};
+
+
+struct planar {
+    std::vector<std::vector<float>> channels;
+    std::vector<float>              mid;
+    std::vector<float>              side;
+};
+
+auto reference_deinterleave(std::vector<float> const& src, std::size_t frames, std::size_t channels) -> planar {
+    auto result = planar{std::vector<std::vector<float>>(channels, std::vector<float>(frames)),
+            std::vector<float>(frames), std::vector<float>(frames)};
+
+    for (std::size_t i = 0; i < frames; i++) {
+        for (std::size_t c = 0; c < channels; c++)
+            result.channels[c][i] = src[i * channels + c];
+
+        if (channels > 1) {
+            result.mid[i]  = (src[i * channels] + src[i * channels + 1]) * 0.5f;
+            result.side[i] = (src[i * channels] - src[i * channels + 1]) * 0.5f;
+        }
+    }
+
+    return result;
+}
+
+auto report(std::string const& name, bool ok) -> bool {
+    std::cout << name << (ok ? ": ok" : ": FAILED") << "\n";
+    return ok;
+}
+
+// The kernels only shuffle and compute (a + b) / 2 and (a - b) / 2, so results must match exactly.
+auto check_stereo(std::string const& name, deinterleave_kernels::stereo_fn<float> fn) -> bool {
+    auto ok = true;
+
+    for (auto const frames : frame_counts) {
+        auto const src      = random_signal(2 * frames, static_cast<std::uint32_t>(frames));
+        auto const expected = reference_deinterleave(src, frames, 2);
+
+        auto left  = std::vector<float>(frames);
+        auto right = std::vector<float>(frames);
+        auto mid   = std::vector<float>(frames);
+        auto side  = std::vector<float>(frames);
+
+        fn(src.data(), frames, left.data(), right.data(), nullptr, nullptr);
+        ok &= left == expected.channels[0] && right == expected.channels[1];
+
+        fn(src.data(), frames, left.data(), right.data(), mid.data(), side.data());
+        ok &= left == expected.channels[0] && right == expected.channels[1];
+        ok &= mid == expected.mid && side == expected.side;
+    }
+
+    return report(name, ok);
+}
+
+auto check_deinterleave(std::size_t channels) -> bool {
+    auto ok = true;
+
+    for (auto const frames : frame_counts) {
+        auto const src      = random_signal(channels * frames, static_cast<std::uint32_t>(frames));
+        auto const expected = reference_deinterleave(src, frames, channels);
+
+        auto actual = std::vector<std::vector<float>>(channels, std::vector<float>(frames));
+        auto dst    = std::vector<float*>(channels);
+        for (std::size_t c = 0; c < channels; c++)
+            dst[c] = actual[c].data();
+
+        auto mid  = std::vector<float>(frames);
+        auto side = std::vector<float>(frames);
+
+        deinterleave(src.data(), frames, channels, dst.data(), mid.data(), side.data());
+        ok &= actual == expected.channels;
+
+        // mid/side requires two channels, mono leaves them untouched
+        ok &= mid == expected.mid && side == expected.side;
+    }
+
+    return report("deinterleave, " + std::to_string(channels) + " channel(s)", ok);
+}
+
+int main() {
+    auto ok = true;
+
+    ok &= check_stereo("stereo_scalar", deinterleave_kernels::stereo_scalar<float>);
+
+#ifdef AVIS_AUDIO_FFT_X86_KERNELS
+    auto const& cpu = utils::get_cpu_features();
+
+    if (cpu.avx2)
+        ok &= check_stereo("stereo_avx2", deinterleave_kernels::stereo_avx2);
+
+    if (cpu.avx512f)
+        ok &= check_stereo("stereo_avx512", deinterleave_kernels::stereo_avx512);
+#endif
+
+    // fixed layouts and the generic fallback
+    for (std::size_t channels : {1, 2, 3, 4, 6, 8})
+        ok &= check_deinterleave(channels);
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,123 @@
+#include "reference.hpp"
+
+#include <avis/audio/cqt.hpp>
+#include <avis/audio/fft.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+using namespace avis;
+using namespace avis::audio;
+using namespace avis::test;
+
+
+constexpr auto n               = std::size_t{4096};
+constexpr auto sample_rate     = 48000.0;
+constexpr auto bins_per_octave = std::size_t{12};
+constexpr auto f_min           = 55.0;
+constexpr auto f_max           = 16000.0;
+
+
+// Correlation of the frame (with the window of fft_plan) with the Hann-windowed complex exponential of each bin,
+// computed in the time domain, scaled as documented for constant_q_transform.
+auto reference_cqt(std::vector<float> const& frame, constant_q_transform<float> const& cqt) -> std::vector<double> {
+    auto const window     = hann_window(n);
+    auto const window_sum = std::accumulate(window.begin(), window.end(), 0.0);
+    auto const q          = 1.0 / (std::pow(2.0, 1.0 / bins_per_octave) - 1.0);
+
+    auto result = std::vector<double>(cqt.output_size());
+    for (std::size_t k = 0; k < result.size(); k++) {
+        auto const f      = cqt.frequency(k);
+        auto const length = std::max<std::size_t>(std::min<std::size_t>(std::ceil(q * sample_rate / f), n), 2);
+        auto const start  = (n - length) / 2;
+
+        auto atom = std::vector<double>(length);
+        auto norm = 0.0;
+        for (std::size_t i = 0; i < length; i++) {
+            atom[i] = 0.5 * (1.0 - std::cos((2.0 * math::pi<double> * (i + 1)) / (length + 1.0)));
+            norm += atom[i] * window[start + i];
+        }
+
+        auto sum = std::complex<double>{};
+        for (std::size_t i = 0; i < length; i++) {
+            auto const t = start + i;
+            sum += std::polar(frame[t] * window[t] * atom[i], -2.0 * math::pi<double> * f * t / sample_rate);
+        }
+
+        result[k] = std::abs(sum) * window_sum / (norm * std::sqrt(double{n}));
+    }
+
+    return result;
+}
+
+auto check_cqt(std::string const& name, std::vector<float> const& frame, double threshold, double tolerance)
+        -> bool
+{
+    auto cqt  = constant_q_transform<float>{n, sample_rate, bins_per_octave, f_min, f_max, threshold};
+    auto plan = dynamic_fft_plan<float>{n};
+
+    auto spectrum = std::vector<std::complex<float>>(rfft_output_size(n));
+    auto actual   = std::vector<float>(cqt.output_size());
+
+    plan.execute_spectrum(frame.begin(), spectrum.data());
+    cqt.apply(spectrum.data(), actual.data());
+
+    auto const error = relative_error(actual, reference_cqt(frame, cqt));
+    auto const ok = error <= tolerance;
+    std::cout << "constant_q_transform " << name << ", threshold " << threshold << ": max. error " << error
+              << (ok ? "" : " FAILED") << "\n";
+    return ok;
+}
+
+// A sinusoid at a bin frequency must have the same magnitude as the peak of a sinusoid at a bin of the FFT, i.e.
+// a window_sum / (2 sqrt(n)), as long as its atom fits into the frame.
+auto check_levels() -> bool {
+    auto cqt  = constant_q_transform<float>{n, sample_rate, bins_per_octave, f_min, f_max};
+    auto plan = dynamic_fft_plan<float>{n};
+
+    auto const window   = hann_window(n);
+    auto const expected = std::accumulate(window.begin(), window.end(), 0.0) / (2.0 * std::sqrt(double{n}));
+    auto const q        = 1.0 / (std::pow(2.0, 1.0 / bins_per_octave) - 1.0);
+
+    auto frame    = std::vector<float>(n);
+    auto spectrum = std::vector<std::complex<float>>(rfft_output_size(n));
+    auto actual   = std::vector<float>(cqt.output_size());
+
+    auto error = 0.0;
+    for (std::size_t k = 0; k < cqt.output_size(); k++) {
+        auto const f = cqt.frequency(k);
+        if (q * sample_rate / f > n)
+            continue;
+
+        for (std::size_t t = 0; t < n; t++)
+            frame[t] = static_cast<float>(std::cos(2.0 * math::pi<double> * f * t / sample_rate));
+
+        plan.execute_spectrum(frame.begin(), spectrum.data());
+        cqt.apply(spectrum.data(), actual.data());
+
+        error = std::max(error, std::abs(20.0 * std::log10(actual[k] / expected)));
+    }
+
+    auto const ok = error <= 0.01;
+    std::cout << "constant_q_transform level of sinusoids at the bin frequencies: max. error " << error << " dB"
+              << (ok ? "" : " FAILED") << "\n";
+    return ok;
+}
+
+int main() {
+    auto const noise = random_signal(n, 1);
+
+    auto ok = true;
+
+    ok &= check_cqt("noise", noise, 0.0, 1e-3);
+    ok &= check_cqt("noise", noise, constant_q_transform<float>::default_threshold, 1e-2);
+    ok &= check_levels();
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,159 @@
+#include "reference.hpp"
+
+#include <avis/audio/decimator.hpp>
+#include <avis/audio/multires.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace avis;
+using namespace avis::audio;
+using namespace avis::test;
+
+
+// Blackman-windowed sinc with the cutoff at 1 / (2 factor) of the input rate and unit gain at DC, as documented for
+// polyphase_decimator (factor taps_per_phase taps) and halfband_filter (factor two, taps taps)
+auto reference_lowpass(std::size_t factor, std::size_t taps) -> std::vector<double> {
+    auto const center = (taps - 1) / 2.0;
+
+    auto h = std::vector<double>(taps);
+    auto sum = 0.0;
+    for (std::size_t t = 0; t < taps; t++) {
+        auto const x = math::pi<double> * (t - center) / factor;
+        auto const w = 0.42 - 0.5 * std::cos(2.0 * math::pi<double> * t / (taps - 1))
+                + 0.08 * std::cos(4.0 * math::pi<double> * t / (taps - 1));
+
+        h[t] = (x == 0.0 ? 1.0 : std::sin(x) / x) * w;
+        sum += h[t];
+    }
+
+    for (auto& c : h)
+        c /= sum;
+
+    return h;
+}
+
+// output j is computed from the inputs j factor to j factor + taps - 1
+auto reference_decimate(std::vector<float> const& x, std::vector<double> const& h, std::size_t factor)
+        -> std::vector<double>
+{
+    auto y = std::vector<double>();
+    for (std::size_t j = 0; j * factor + h.size() <= x.size(); j++) {
+        auto sum = 0.0;
+        for (std::size_t t = 0; t < h.size(); t++)
+            sum += h[t] * x[j * factor + t];
+
+        y.push_back(sum);
+    }
+
+    return y;
+}
+
+auto report(std::string const& name, double error, double tolerance) -> bool {
+    auto const ok = error <= tolerance;
+    std::cout << name << ": max. error " << error << (ok ? "" : " FAILED") << "\n";
+    return ok;
+}
+
+// Streaming in blocks of varying size must produce the same outputs as filtering the whole input at once.
+auto check_polyphase(std::size_t factor) -> bool {
+    auto const input = random_signal(20000, static_cast<std::uint32_t>(factor));
+
+    auto decimator = polyphase_decimator<float>{factor};
+    auto expected  = reference_decimate(input, reference_lowpass(factor, decimator.filter_size()), factor);
+
+    auto actual = std::vector<float>();
+    auto block  = std::size_t{1};
+    for (std::size_t i = 0; i < input.size(); i += block, block = block * 7 % 1013 + 1) {
+        auto const count = std::min(block, input.size() - i);
+        decimator.process(input.data() + i, count, std::back_inserter(actual));
+    }
+
+    if (actual.size() != expected.size()) {
+        std::cout << "polyphase_decimator(" << factor << "): " << actual.size() << " outputs, expected "
+                  << expected.size() << " FAILED\n";
+        return false;
+    }
+
+    return report("polyphase_decimator(" + std::to_string(factor) + ")", relative_error(actual, expected), 1e-5);
+}
+
+auto check_halfband() -> bool {
+    constexpr auto taps  = halfband_filter<float>::taps;
+    constexpr auto count = std::size_t{1000};
+
+    auto const input    = random_signal(2 * (count - 1) + taps, 2);
+    auto const expected = reference_decimate(input, reference_lowpass(2, taps), 2);
+
+    auto filter = halfband_filter<float>{};
+    auto actual = std::vector<float>(count);
+    filter.decimate(input.begin(), actual.data(), count);
+
+    return report("halfband_filter", relative_error(actual, expected), 1e-5);
+}
+
+// Each level must match the DFT of the central window of the input decimated level times by the halfband filter
+// (the cascade computed in double precision), restricted to the bins the level contributes to the row.
+auto check_multires(std::size_t n, std::size_t levels) -> bool {
+    auto plan = multires_plan<float>{n, levels};
+
+    auto const input  = random_signal(plan.input_size(), 3);
+    auto const window = hann_window(n);
+    auto const h      = reference_lowpass(2, halfband_filter<float>::taps);
+
+    auto actual = std::vector<float>(plan.output_size());
+    plan.execute(input.begin(), actual.begin());
+
+    auto ok = true;
+    auto signal = std::vector<double>(input.begin(), input.end());
+
+    for (std::size_t level = 0; level < levels; level++) {
+        if (level > 0) {
+            auto decimated = std::vector<double>();
+            for (std::size_t j = 0; 2 * j + h.size() <= signal.size(); j++) {
+                auto sum = 0.0;
+                for (std::size_t t = 0; t < h.size(); t++)
+                    sum += h[t] * signal[2 * j + t];
+
+                decimated.push_back(sum);
+            }
+
+            signal = std::move(decimated);
+        }
+
+        auto const spectrum = dft(signal.begin() + (signal.size() - n) / 2, window);
+
+        // all but the last level start at 0.4 of their Nyquist frequency
+        auto const begin = level + 1 < levels ? n / 5 : std::size_t{0};
+
+        auto expected = std::vector<double>(plan.level_size(level));
+        auto result   = std::vector<float>(plan.level_size(level));
+        for (std::size_t i = 0; i < expected.size(); i++) {
+            expected[i] = std::abs(spectrum[begin + i]);
+            result[i]   = actual[plan.level_offset(level) + i];
+        }
+
+        ok &= report("multires_plan(" + std::to_string(n) + ", " + std::to_string(levels) + ") level "
+                + std::to_string(level), relative_error(result, expected), 1e-5);
+    }
+
+    return ok;
+}
+
+int main() {
+    auto ok = true;
+
+    ok &= check_polyphase(2);
+    ok &= check_polyphase(3);
+    ok &= check_polyphase(4);
+    ok &= check_polyphase(8);
+    ok &= check_halfband();
+    ok &= check_multires(1024, 4);
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,155 @@
+#include "reference.hpp"
+
+#include <avis/audio/fft.hpp>
+
+#include <algorithm>
+#include <complex>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace avis::audio;
+using namespace avis::test;
+
+
+constexpr auto tolerance = 1e-5;        // relative to the peak magnitude
+
+
+auto report(std::string const& name, double error) -> bool {
+    auto const ok = error <= tolerance;
+    std::cout << name << ": max. error " << error << (ok ? "" : " FAILED") << "\n";
+    return ok;
+}
+
+// The magnitudes, the complex spectrum and both channels of the stereo transform must match the unitary DFT of the
+// input windowed by the symmetric Hann window, in particular for the mixed-radix and Bluestein sizes.
+template <class Plan>
+auto check_plan(std::string const& name, Plan& plan, std::size_t n) -> bool {
+    auto const window = hann_window(n);
+    auto const left   = random_signal(n, static_cast<std::uint32_t>(n));
+    auto const right  = random_signal(n, static_cast<std::uint32_t>(n + 1));
+
+    auto const expected_left  = dft(left.begin(), window);
+    auto const expected_right = dft(right.begin(), window);
+
+    auto magnitudes = std::vector<double>(expected_left.size());
+    std::transform(expected_left.begin(), expected_left.end(), magnitudes.begin(),
+            [](auto const& x) { return std::abs(x); });
+
+    auto actual   = std::vector<float>(expected_left.size());
+    auto spectrum = std::vector<std::complex<float>>(expected_left.size());
+    auto stereo_l = std::vector<float>(expected_left.size());
+    auto stereo_r = std::vector<float>(expected_left.size());
+
+    plan.execute(left.begin(), actual.begin());
+    plan.execute_spectrum(left.begin(), spectrum.data());
+    plan.execute_stereo(left.begin(), right.begin(), stereo_l.begin(), stereo_r.begin());
+
+    auto magnitudes_right = std::vector<double>(expected_right.size());
+    std::transform(expected_right.begin(), expected_right.end(), magnitudes_right.begin(),
+            [](auto const& x) { return std::abs(x); });
+
+    auto ok = true;
+    ok &= report(name + " execute", relative_error(actual, magnitudes));
+    ok &= report(name + " execute_spectrum", relative_error(spectrum, expected_left));
+    ok &= report(name + " execute_stereo", std::max(relative_error(stereo_l, magnitudes),
+            relative_error(stereo_r, magnitudes_right)));
+    return ok;
+}
+
+// For sizes too large for the full reference DFT, a subset of the bins spread over the spectrum is compared,
+// including the lowest and highest ones.
+template <class Plan>
+auto check_plan_bins(std::string const& name, Plan& plan, std::size_t n) -> bool {
+    auto const window = hann_window(n);
+    auto const left   = random_signal(n, static_cast<std::uint32_t>(n));
+    auto const right  = random_signal(n, static_cast<std::uint32_t>(n + 1));
+
+    auto bins = std::vector<std::size_t>{0, 1, 2, n / 2 - 1, n / 2};
+    for (std::size_t i = 1; i < 24; i++)
+        bins.push_back(i * (n / 2) / 24 + (i * 37) % (n / 48));
+
+    auto const size = n / 2 + 1;
+
+    auto actual   = std::vector<float>(size);
+    auto spectrum = std::vector<std::complex<float>>(size);
+    auto stereo_l = std::vector<float>(size);
+    auto stereo_r = std::vector<float>(size);
+
+    plan.execute(left.begin(), actual.begin());
+    plan.execute_spectrum(left.begin(), spectrum.data());
+    plan.execute_stereo(left.begin(), right.begin(), stereo_l.begin(), stereo_r.begin());
+
+    auto expected_left  = std::vector<std::complex<double>>();
+    auto expected_right = std::vector<std::complex<double>>();
+    auto magnitudes_left  = std::vector<double>();
+    auto magnitudes_right = std::vector<double>();
+
+    auto subset_actual   = std::vector<float>();
+    auto subset_spectrum = std::vector<std::complex<float>>();
+    auto subset_stereo_l = std::vector<float>();
+    auto subset_stereo_r = std::vector<float>();
+
+    for (auto const k : bins) {
+        expected_left.push_back(dft_bin(left.begin(), window, k));
+        expected_right.push_back(dft_bin(right.begin(), window, k));
+        magnitudes_left.push_back(std::abs(expected_left.back()));
+        magnitudes_right.push_back(std::abs(expected_right.back()));
+
+        subset_actual.push_back(actual[k]);
+        subset_spectrum.push_back(spectrum[k]);
+        subset_stereo_l.push_back(stereo_l[k]);
+        subset_stereo_r.push_back(stereo_r[k]);
+    }
+
+    auto ok = true;
+    ok &= report(name + " execute", relative_error(subset_actual, magnitudes_left));
+    ok &= report(name + " execute_spectrum", relative_error(subset_spectrum, expected_left));
+    ok &= report(name + " execute_stereo", std::max(relative_error(subset_stereo_l, magnitudes_left),
+            relative_error(subset_stereo_r, magnitudes_right)));
+    return ok;
+}
+
+template <std::size_t N>
+auto check_sizes() -> bool {
+    auto plan    = std::make_unique<fft_plan<N>>();
+    auto dynamic = dynamic_fft_plan<float>(N);
+
+    auto ok = true;
+    ok &= check_plan("fft_plan<" + std::to_string(N) + ">", *plan, N);
+    ok &= check_plan("dynamic_fft_plan(" + std::to_string(N) + ")", dynamic, N);
+    return ok;
+}
+
+template <std::size_t N>
+auto check_large_sizes() -> bool {
+    auto plan    = std::make_unique<fft_plan<N>>();
+    auto dynamic = dynamic_fft_plan<float>(N);
+
+    auto ok = true;
+    ok &= check_plan_bins("fft_plan<" + std::to_string(N) + ">", *plan, N);
+    ok &= check_plan_bins("dynamic_fft_plan(" + std::to_string(N) + ")", dynamic, N);
+    return ok;
+}
+
+int main() {
+    auto ok = true;
+
+    ok &= check_sizes<1000>();      // mixed-radix (2, 5)
+    ok &= check_sizes<1920>();      // mixed-radix (2, 3, 5)
+    ok &= check_sizes<4099>();      // prime, Bluestein
+    ok &= check_sizes<4096>();      // power of two
+
+    // Stockham kernels (real and stereo), not instantiated statically as the tables take too long to compile
+    auto dynamic = dynamic_fft_plan<float>(16384);
+    ok &= check_plan("dynamic_fft_plan(16384)", dynamic, 16384);
+
+    // four-step decomposition, of the stereo transform only (32768) and of both (65536, 2^20)
+    ok &= check_large_sizes<32768>();
+    ok &= check_large_sizes<65536>();
+    ok &= check_large_sizes<1048576>();
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,120 @@
+#include "reference.hpp"
+
+#include <avis/audio/filterbank.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace avis::audio;
+using namespace avis::test;
+
+
+constexpr auto n           = std::size_t{4096};
+constexpr auto sample_rate = 48000.0;
+
+
+auto to_scale(frequency_scale scale, double f) -> double {
+    switch (scale) {
+    case frequency_scale::mel:  return 2595.0 * std::log10(1.0 + f / 700.0);
+    case frequency_scale::log:  return std::log(f);
+    default:                    return f;
+    }
+}
+
+auto from_scale(frequency_scale scale, double v) -> double {
+    switch (scale) {
+    case frequency_scale::mel:  return 700.0 * (std::pow(10.0, v / 2595.0) - 1.0);
+    case frequency_scale::log:  return std::exp(v);
+    default:                    return v;
+    }
+}
+
+// Dense filter matrix as documented for filterbank: triangles from the center of the previous to the center of the
+// next band with unit sum, linear interpolation between the bins around the center if no bin lies strictly inside.
+auto reference_filters(std::size_t bands, frequency_scale scale, double f_min, double f_max)
+        -> std::vector<std::vector<double>>
+{
+    auto const bins = rfft_output_size(n);
+    auto const edge = [&](std::size_t i) {
+        auto const v = to_scale(scale, f_min) + (to_scale(scale, f_max) - to_scale(scale, f_min)) * i / (bands + 1);
+        return std::min(from_scale(scale, v) * n / sample_rate, static_cast<double>(bins - 1));
+    };
+
+    auto filters = std::vector<std::vector<double>>(bands, std::vector<double>(bins));
+    for (std::size_t b = 0; b < bands; b++) {
+        auto const lower  = edge(b);
+        auto const center = edge(b + 1);
+        auto const upper  = edge(b + 2);
+        auto& f = filters[b];
+
+        auto sum = 0.0;
+        for (std::size_t k = 0; k < bins; k++) {
+            if (k > lower && k < upper)
+                f[k] = k <= center ? (k - lower) / (center - lower) : (upper - k) / (upper - center);
+
+            sum += f[k];
+        }
+
+        if (sum > 0.0 && std::count_if(f.begin(), f.end(), [](double w) { return w > 0.0; }) > 1) {
+            for (auto& w : f)
+                w /= sum;
+        } else {
+            std::fill(f.begin(), f.end(), 0.0);
+
+            auto const k = std::min(static_cast<std::size_t>(center), bins - 2);
+            f[k]     = 1.0 - (center - k);
+            f[k + 1] = center - k;
+        }
+    }
+
+    return filters;
+}
+
+auto check_filterbank(std::string const& name, std::size_t bands, frequency_scale scale, double f_min,
+        double f_max) -> bool
+{
+    auto const fb      = filterbank<float>{n, sample_rate, bands, scale, f_min, f_max};
+    auto const filters = reference_filters(bands, scale, f_min, f_max);
+
+    // magnitudes are non-negative
+    auto input = random_signal(rfft_output_size(n), 1);
+    for (auto& x : input)
+        x = std::abs(x);
+
+    auto expected = std::vector<double>(bands);
+    for (std::size_t b = 0; b < bands; b++) {
+        for (std::size_t k = 0; k < input.size(); k++)
+            expected[b] += filters[b][k] * input[k];
+    }
+
+    auto actual = std::vector<float>(fb.output_size());
+    fb.apply(input.data(), actual.data());
+
+    // unit sum: a constant input results in the same constant in all bands
+    auto const constant = std::vector<float>(input.size(), 1.0f);
+    auto ones = std::vector<float>(fb.output_size());
+    fb.apply(constant.data(), ones.data());
+
+    auto const error     = relative_error(actual, expected);
+    auto const error_sum = relative_error(ones, std::vector<double>(bands, 1.0));
+
+    auto const ok = fb.output_size() == bands && error <= 1e-5 && error_sum <= 1e-5;
+    std::cout << "filterbank " << name << ": max. error " << error << ", max. error of the unit sum " << error_sum
+              << (ok ? "" : " FAILED") << "\n";
+    return ok;
+}
+
+int main() {
+    auto ok = true;
+
+    // the low mel and log bands are narrower than the bins
+    ok &= check_filterbank("linear", 256, frequency_scale::linear, 0.0, 20000.0);
+    ok &= check_filterbank("mel", 256, frequency_scale::mel, 0.0, 20000.0);
+    ok &= check_filterbank("log", 256, frequency_scale::log, 20.0, 20000.0);
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,106 @@
+#include <avis/offline.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace avis;
+
+
+// Renders the same file segmented (one segment per worker, each decoded from its own seek point) and sequentially,
+// the rows must match across the seams. The input should be a compressed file (e.g. MP3, Ogg Vorbis) of at least
+// segments * 30 seconds, as the seek points and the positions reported after seeking are the part under test.
+constexpr auto segments  = std::size_t{4};
+constexpr auto window    = std::size_t{4096};
+constexpr auto hop       = std::size_t{1024};
+
+// relative to the peak magnitude of the file: admits the sub-sample offset of a resampler restarted after seeking,
+// for broadband input a segment offset by two samples exceeds it
+constexpr auto tolerance = 1e-3f;
+
+constexpr auto format = audio::ffmpeg::stream_format{2, AV_CH_LAYOUT_STEREO, AV_SAMPLE_FMT_FLT, 48000};
+
+
+struct spectrogram {
+    spectrogram_header header;
+    std::vector<float> data;
+};
+
+auto read_spectrogram(std::string const& path) -> spectrogram {
+    auto file = std::ifstream();
+    file.exceptions(std::ios::failbit | std::ios::badbit);
+    file.open(path, std::ios::binary);
+
+    auto result = spectrogram{};
+    file.read(reinterpret_cast<char*>(&result.header), sizeof(result.header));
+
+    result.data.resize(result.header.rows * result.header.layers * result.header.bins);
+    file.read(reinterpret_cast<char*>(result.data.data()), result.data.size() * sizeof(float));
+
+    return result;
+}
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        std::cout << "Usage: " << argv[0] << " <compressed audio file>\n";
+        return EXIT_FAILURE;
+    }
+
+    av_register_all();
+
+    auto const input = std::string{argv[1]};
+    auto const path_sequential = std::string{"offline_segments_sequential.avsp"};
+    auto const path_segmented  = std::string{"offline_segments_segmented.avsp"};
+
+    offline_renderer sequential{format, window, hop, 1};
+    offline_renderer segmented{format, window, hop, segments};
+
+    auto const stats_sequential = sequential.render(input, path_sequential);
+    auto const stats_segmented  = segmented.render(input, path_segmented);
+
+    if (stats_segmented.segments != static_cast<std::int64_t>(segments)) {
+        std::cout << "rendered sequentially, the file is too short or its reported duration is off FAILED\n";
+        return EXIT_FAILURE;
+    }
+
+    auto const expected = read_spectrogram(path_sequential);
+    auto const actual   = read_spectrogram(path_segmented);
+
+    std::cout << "rows: " << actual.header.rows << " segmented, " << expected.header.rows << " sequential\n";
+    std::cout << "frames: " << stats_segmented.frames << " segmented, " << stats_sequential.frames << " sequential\n";
+
+    // positions after seeking are derived from timestamps, rounded to the output sample rate
+    if (std::memcmp(&actual.header, &expected.header, sizeof(spectrogram_header)) != 0
+            || std::abs(stats_segmented.frames - stats_sequential.frames) > 1) {
+        std::cout << "headers differ FAILED\n";
+        return EXIT_FAILURE;
+    }
+
+    auto const row_size = static_cast<std::size_t>(expected.header.layers * expected.header.bins);
+    auto const peak = *std::max_element(expected.data.begin(), expected.data.end());
+
+    auto error = 0.0f;
+    auto worst = std::size_t{0};
+    for (std::size_t i = 0; i < expected.data.size(); i++) {
+        auto const e = std::abs(actual.data[i] - expected.data[i]);
+
+        if (e > error) {
+            error = e;
+            worst = i / row_size;
+        }
+    }
+
+    auto const ok = error <= tolerance * peak;
+    std::cout << "max. error " << error / peak << " in row " << worst << (ok ? "" : " FAILED") << "\n";
+
+    std::remove(path_sequential.c_str());
+    std::remove(path_segmented.c_str());
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
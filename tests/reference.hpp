@@ -0,0 +1,87 @@
+#pragma once
+
+#include <avis/utils/constexpr_math.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+
+namespace avis {
+namespace test {
+
+// Straightforward double precision implementations of what the transforms compute, to test them against.
+
+inline auto random_signal(std::size_t n, std::uint32_t seed) -> std::vector<float> {
+    auto rng  = std::mt19937{seed};
+    auto dist = std::uniform_real_distribution<float>{-1.0f, 1.0f};
+
+    auto signal = std::vector<float>(n);
+    std::generate(signal.begin(), signal.end(), [&]() { return dist(rng); });
+    return signal;
+}
+
+// symmetric Hann window, as applied by fft_plan and dynamic_fft_plan
+inline auto hann_window(std::size_t n) -> std::vector<double> {
+    auto window = std::vector<double>(n);
+    for (std::size_t i = 0; i < n; i++)
+        window[i] = 0.5 * (1.0 - std::cos((2.0 * math::pi<double> * i) / (n - 1.0)));
+
+    return window;
+}
+
+// periodic Hann window, as applied by sliding_dft
+inline auto hann_window_periodic(std::size_t n) -> std::vector<double> {
+    auto window = std::vector<double>(n);
+    for (std::size_t i = 0; i < n; i++)
+        window[i] = 0.5 * (1.0 - std::cos((2.0 * math::pi<double> * i) / n));
+
+    return window;
+}
+
+// bin k of the unitary DFT of the weighted input, i.e. in the scale of the rows written by fft_plan
+template <class InputIterator>
+auto dft_bin(InputIterator x, std::vector<double> const& weights, std::size_t k) -> std::complex<double> {
+    auto const n = weights.size();
+
+    auto sum = std::complex<double>{};
+    for (std::size_t i = 0; i < n; i++, ++x) {
+        auto const arg = -2.0 * math::pi<double> * static_cast<double>((k * i) % n) / n;
+        sum += std::polar(weights[i] * static_cast<double>(*x), arg);
+    }
+
+    return sum / std::sqrt(static_cast<double>(n));
+}
+
+// bins 0 to n/2 of the unitary DFT of the weighted input
+template <class InputIterator>
+auto dft(InputIterator x, std::vector<double> const& weights) -> std::vector<std::complex<double>> {
+    auto result = std::vector<std::complex<double>>(weights.size() / 2 + 1);
+    for (std::size_t k = 0; k < result.size(); k++)
+        result[k] = dft_bin(x, weights, k);
+
+    return result;
+}
+
+// maximum absolute difference, relative to the maximum magnitude of the reference
+template <class T, class U>
+auto relative_error(std::vector<T> const& actual, std::vector<U> const& expected) -> double {
+    auto error = 0.0;
+    auto peak  = 0.0;
+
+    for (std::size_t i = 0; i < expected.size(); i++) {
+        auto const a = std::complex<double>(actual[i]);
+        auto const e = std::complex<double>(expected[i]);
+
+        error = std::max(error, std::abs(a - e));
+        peak  = std::max(peak, std::abs(e));
+    }
+
+    return peak > 0.0 ? error / peak : error;
+}
+
+} /* namespace test */
+} /* namespace avis */
@@ -0,0 +1,78 @@
+#include "reference.hpp"
+
+#include <avis/audio/sdft.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+using namespace avis::audio;
+using namespace avis::test;
+
+
+constexpr auto n   = std::size_t{1024};
+constexpr auto hop = std::size_t{97};
+
+
+// After each hop, the requested bins must match the unitary DFT of the last n samples windowed by the periodic Hann
+// window, where the damping weights the sample of age a by r^(a + 1), scaled to the window sum of fft_plan; all
+// other bins must be zero.
+auto check_sliding_dft(float damping, double tolerance) -> bool {
+    auto const bins   = std::vector<std::size_t>{0, 1, 2, 17, 255, 256, 511, 512};
+    auto const signal = random_signal(4 * n + hop, 1);
+
+    auto weights = hann_window_periodic(n);
+    for (std::size_t i = 0; i < n; i++)
+        weights[i] *= std::pow(static_cast<double>(damping), static_cast<double>(n - i));
+
+    auto const symmetric = hann_window(n);
+    auto const gain = std::accumulate(symmetric.begin(), symmetric.end(), 0.0)
+            / std::accumulate(weights.begin(), weights.end(), 0.0);
+
+    for (auto& w : weights)
+        w *= gain;
+
+    auto sdft = sliding_dft<float>{n, bins, damping};
+    auto row  = std::vector<float>(sdft.output_size());
+
+    auto error = 0.0;
+    auto zeros = true;
+
+    for (std::size_t end = hop; end <= signal.size(); end += hop) {
+        for (std::size_t i = end - hop; i < end; i++)
+            sdft.update(signal[i]);
+
+        // the history starts out as zeros
+        if (end < n)
+            continue;
+
+        sdft.write(row.begin());
+
+        auto expected = std::vector<double>(row.size());
+        for (auto const k : bins)
+            expected[k] = std::abs(dft_bin(signal.begin() + (end - n), weights, k));
+
+        error = std::max(error, relative_error(row, expected));
+        for (std::size_t k = 0; k < row.size(); k++)
+            zeros &= std::find(bins.begin(), bins.end(), k) != bins.end() || row[k] == 0.0f;
+    }
+
+    auto const ok = error <= tolerance && zeros;
+    std::cout << "sliding_dft(" << n << ", damping " << damping << "): max. error " << error
+              << (zeros ? "" : ", bins not requested are not zero") << (ok ? "" : " FAILED") << "\n";
+    return ok;
+}
+
+int main() {
+    auto ok = true;
+
+    ok &= check_sliding_dft(sliding_dft<float>::default_damping, 1e-3);
+    ok &= check_sliding_dft(1.0f, 1e-3);
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}